@@ -0,0 +1,95 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// echo server as a coroutine: no blocking uart_getc, so a blinking
+// heartbeat runs alongside it on the same stack. before serving we
+// measure what a coroutine costs in ram and per resume.
+
+#define LED_PIN     16
+#define NBENCH      8
+#define BENCH_ITERS 10000
+
+struct echo {
+    struct async_task task;
+    volatile struct uart *uart;
+    char c;
+};
+
+static int echo_fn(struct async_task *t) {
+    struct echo *e = async_container_of(t, struct echo, task);
+
+    ASYNC_BEGIN(t);
+    while (1) {
+        AWAIT_UART_RX(t, e->uart);
+        e->c = uart_getc(e->uart);
+        AWAIT_UART_TX(t, e->uart);
+        uart_putc(e->uart, e->c);
+    }
+    ASYNC_END(t);
+}
+
+struct blink {
+    struct async_task task;
+    unsigned on;
+};
+
+static int blink_fn(struct async_task *t) {
+    struct blink *b = async_container_of(t, struct blink, task);
+
+    ASYNC_BEGIN(t);
+    while (1) {
+        b->on ^= 1;
+        gpio_write(LED_PIN, b->on);
+        AWAIT_SLEEP_US(t, 500 * 1000);
+    }
+    ASYNC_END(t);
+}
+
+struct spinner {
+    struct async_task task;
+    unsigned n;
+};
+
+static int spinner_fn(struct async_task *t) {
+    struct spinner *s = async_container_of(t, struct spinner, task);
+
+    ASYNC_BEGIN(t);
+    for (s->n = 0; s->n < BENCH_ITERS; s->n++)
+        AWAIT_YIELD(t);
+    ASYNC_END(t);
+}
+
+static void bench(void) {
+    static struct spinner spinners[NBENCH];
+
+    for (unsigned i = 0; i < NBENCH; i++)
+        async_spawn(&spinners[i].task, spinner_fn);
+
+    uint64_t resumes = async_get_stats()->resumes;
+    uint64_t start = cycle_cnt_read();
+    async_run();
+    uint64_t cycles = cycle_cnt_read() - start;
+    resumes = async_get_stats()->resumes - resumes;
+
+    bench_put(UART0, "task bytes:        ", sizeof(struct async_task), "\r\n");
+    bench_put(UART0, "echo bytes:        ", sizeof(struct echo), "\r\n");
+    bench_put(UART0, "resumes:           ", resumes, "\r\n");
+    bench_put(UART0, "cycles per resume: ", cycles / resumes, "\r\n");
+}
+
+static struct echo echo = { .uart = 0 };
+static struct blink blink;
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    clint_init();
+    gpio_set_output(LED_PIN);
+    uart_puts(UART0, "async-echo\r\n");
+
+    bench();
+
+    echo.uart = UART0;
+    async_spawn(&echo.task, echo_fn);
+    async_spawn(&blink.task, blink_fn);
+    async_run();
+}
@@ -1,99 +1,52 @@
 #define LOG_LEVEL 3
 #include "lib.h"
 
-// Helper function to convert an integer to a hexadecimal string and print using putc
-void itoa_hex(uint64_t num) {
-    static const char hex_digits[] = "0123456789ABCDEF";
-
-    // Print the '0x' prefix
-    uart_putc(UART0, '0');
-    uart_putc(UART0, 'x');
-
-    // Print each hexadecimal digit
-    for (int i = 60; i >= 0; i -= 4) {
-        uart_putc(UART0, hex_digits[(num >> i) & 0xF]);
+// IR transmitter on pin 17: a 38 kHz NEC style leader, one byte msb
+// first and a stop mark, once a second. the carrier comes from the PWM
+// block; lib/wave.c only gates it on and off at the mark/space
+// boundaries from the timer interrupt, so the core sleeps in between.
+
+#define PIN      17
+#define FREQ     (38 * 1000)
+#define NSTEPS   64
+
+static struct wave_step steps[NSTEPS];
+static struct wave frame;
+
+static void build_byte(struct wave *w, uint8_t byte) {
+    for (int i = 7; i >= 0; i--) {
+        wave_mark(w, WAVE_US(600));
+        wave_space(w, (byte >> i) & 1 ? WAVE_US(1600) : WAVE_US(600));
     }
 }
 
-#define FREQ        (38 * 1000)
-#define DELAY_US    ((1000 * 1000) / (FREQ * 2))
-
-#define VAL_N_US(us)   (((us) * FREQ) / 1000000)
-
-#define ON(pin)  do { \
-    uint32_t val = get32(gpio_cfg0 + (pin)); \
-    val |= (1 << 25); \
-    put32(gpio_cfg0 + (pin), val); \
-} while (0)
-
-#define OFF(pin) do { \
-    uint32_t val = get32(gpio_cfg0 + (pin)); \
-    val |= (1 << 26); \
-    put32(gpio_cfg0 + (pin), val); \
-} while (0)
-
-#define GENERATE_WAVEFORM(pin, duration_us) do { \
-    for (int _i = 0; _i < VAL_N_US(duration_us); _i++) { \
-        ON(pin); \
-        delay_us(DELAY_US); \
-        OFF(pin); \
-        delay_us(DELAY_US); \
-    } \
-} while (0)
-
-#define SEND_HEADER(pin) do { \
-    GENERATE_WAVEFORM(pin, 9000); \
-    delay_us(4500); \
-} while (0)
-
-#define SEND_ZERO(pin) do { \
-    GENERATE_WAVEFORM(pin, 600); \
-    delay_us(600); \
-} while (0)
-
-#define SEND_ONE(pin) do { \
-    GENERATE_WAVEFORM(pin, 600); \
-    delay_us(1600); \
-} while (0)
-
-#define SEND_BIT(pin, bit) do { \
-    if ((bit) == 0) { \
-        SEND_ZERO(pin); \
-    } else { \
-        SEND_ONE(pin); \
-    } \
-} while (0)
-
-#define SEND_STOP(pin) do { \
-    GENERATE_WAVEFORM(pin, 600); \
-    delay_us(40000); \
-} while (0)
-
-#define SEND_BYTE(pin, byte) do { \
-    SEND_BIT(pin, (byte) & 0x80); \
-    SEND_BIT(pin, (byte) & 0x40); \
-    SEND_BIT(pin, (byte) & 0x20); \
-    SEND_BIT(pin, (byte) & 0x10); \
-    SEND_BIT(pin, (byte) & 0x08); \
-    SEND_BIT(pin, (byte) & 0x04); \
-    SEND_BIT(pin, (byte) & 0x02); \
-    SEND_BIT(pin, (byte) & 0x01); \
-} while (0)
-
-static volatile uint32_t *const gpio_cfg0 = (volatile uint32_t *)0x200008c4;
-
 void kmain(void) {
     uart_init(UART0, 115200);
-    gpio_set_output(17);
+    trap_init();
 
-    while (1) {
-        SEND_HEADER(17);
-        
-        SEND_BYTE(17, 0x48);
+    pwm_init(0, FREQ);
+    pwm_attach(0, PIN, 50);
+    pwm_gate_t carrier = pwm_gate(0, PIN);
 
-        SEND_STOP(17);
+    // marks are just "carrier on", so no software carrier
+    wave_init(&frame, steps, NSTEPS, 0);
+    wave_mark(&frame, WAVE_US(9000));
+    wave_space(&frame, WAVE_US(4500));
+    build_byte(&frame, 0x48);
+    wave_mark(&frame, WAVE_US(600));
+    wave_space(&frame, WAVE_US(40000));
 
+    while (1) {
+        wave_send(&frame, carrier);
+
+        // check and sleep with MIE off, or the last boundary can slip
+        // in between and leave us in wfi for good. wfi still wakes on
+        // the pending interrupt, which is then taken in the window
+        while (wave_sending()) {
+            asm volatile("wfi");
+            irq_enable();
+            irq_disable();
+        }
         delay_ms(1000);
     }
 }
-
@@ -0,0 +1,55 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// baseline numbers for the hot lib paths, run through lib/bench.h.
+// capture the output of two builds and compare them with
+//   tools/bench-diff.py before.log after.log
+
+static uint8_t src[4096];
+static uint8_t dst[4096];
+static volatile uint32_t sink;
+
+BENCH(memcpy_4k) {
+    memcpy(dst, src, sizeof(dst));
+}
+
+BENCH(memset_4k) {
+    memset(dst, 0, sizeof(dst));
+}
+
+BENCH(crc32_1k) {
+    sink = crc32(src, 1024);
+}
+
+// same thing from cold caches
+BENCH_FLAGS(crc32_1k_cold, BENCH_FLUSH) {
+    sink = crc32(src, 1024);
+}
+
+BENCH(kmalloc_kfree_64) {
+    kfree(kmalloc(64));
+}
+
+// one uncached MMIO read
+BENCH(uart_can_putc) {
+    sink = uart_can_putc(UART0);
+}
+
+BENCH(clint_mtime) {
+    sink = clint_mtime();
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "bench-lib\r\n");
+
+    kmalloc_init();
+    clint_init();
+
+    struct bench_opts opts = BENCH_OPTS_DEFAULT;
+    bench_run_all(UART0, &opts);
+    uart_puts(UART0, "done\r\n");
+
+    while (1)
+        asm volatile("wfi");
+}
@@ -0,0 +1,243 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// resident uart bootloader. build with `make boot.bin` (memmap-boot.ld)
+// and flash it once; after that `make load` sends an image over UART0
+// with tools/uart-load.py and we jump into it.
+//
+// host -> target frames, little endian:
+//   u8 sof | u8 type | u16 seq | u32 addr | u32 len | len bytes | u32 crc
+// crc is crc32_inc over everything from sof to the end of the data.
+// target -> host replies are 4 bytes:
+//   u8 code | u8 window | u16 seq
+//
+// ACK carries the next seq we expect, so acks are cumulative and the
+// host keeps up to `window` frames in flight without waiting on a round
+// trip. on a bad crc or a seq from the future we send one NAK with the
+// seq we want and drop everything until it shows up again (go-back-n).
+// ERR means a good frame we can't honour; the host gives up.
+//
+//   HELLO   addr = baud to switch to (0 stays), acked at the old rate,
+//           ERR if the uart can't make it. starts a new session at
+//           seq + 1 whatever came before
+//   DATA    copy the len bytes to addr, must be inside the load area
+//   INFLATE start an LZ4 block that decompresses to addr, data is the
+//           u32 size it must come out as
+//   LZ4     next piece of that block, decompressed as it arrives
+//   JUMP    acked, then we jump to addr
+// INFLATE and JUMP first check that the open block (if any) ended
+// exactly at its size.
+
+#define BOOT_BAUD      115200 // until a HELLO asks for more
+#define BOOT_SOF       0x5a
+#define BOOT_HELLO     'H'
+#define BOOT_DATA      'D'
+#define BOOT_JUMP      'J'
+#define BOOT_INFLATE   'I'
+#define BOOT_LZ4       'Z'
+#define BOOT_ACK       'A'
+#define BOOT_NAK       'N'
+#define BOOT_ERR       'E'
+#define BOOT_CHUNK_MAX 4096
+#define BOOT_WINDOW    8
+
+struct boot_hdr {
+    u8 sof;
+    u8 type;
+    u16 seq;
+    u32 addr;
+    u32 len;
+} PACKED;
+
+extern char __load_start__[], __load_end__[];
+
+// a full window of max size frames fits with room to spare
+static u8 rx_buf[64 * 1024];
+static struct uart_ring rx;
+static u8 chunk[BOOT_CHUNK_MAX];
+
+// the next frames keep arriving while we work on this one. the 32
+// byte rx fifo lasts 160us at 2 Mbaud and 80us at 4 Mbaud, so every
+// pass over a chunk (crc, copy, decompression) goes in slices this big
+// with a pump in between
+#define SLICE 256
+
+// a piece of compressed data can turn into a lot of output, keep the
+// rx fifo drained in between
+#define LZ4_SLICE SLICE
+
+static struct lz4_stream lz;
+static bool lz_open;
+static u32 lz_size;
+
+static void reply(u8 code, u16 seq) {
+    uart_putc(UART0, code);
+    uart_putc(UART0, BOOT_WINDOW);
+    uart_putc(UART0, seq & 0xff);
+    uart_putc(UART0, seq >> 8);
+}
+
+// false if the frame is damaged
+static bool recv_frame(struct boot_hdr *h) {
+    // hunt for the start of a frame
+    do
+        h->sof = uart_ring_getc(&rx);
+    while (h->sof != BOOT_SOF);
+
+    uart_ring_read(&rx, &h->type, sizeof(*h) - 1);
+    if (h->len > BOOT_CHUNK_MAX)
+        return false;
+
+    // crc each slice as it comes in, the read pumps in between
+    u32 crc = crc32_inc(h, sizeof(*h), 0);
+    for (u32 off = 0; off < h->len; off += SLICE) {
+        u32 n = h->len - off < SLICE ? h->len - off : SLICE;
+        uart_ring_read(&rx, chunk + off, n);
+        crc = crc32_inc(chunk + off, n, crc);
+    }
+
+    u32 want;
+    uart_ring_read(&rx, &want, sizeof(want));
+    return want == crc;
+}
+
+static void copy_out(u8 *dst, const u8 *src, u32 len) {
+    for (u32 off = 0; off < len; off += SLICE) {
+        u32 n = len - off < SLICE ? len - off : SLICE;
+        memcpy(dst + off, src + off, n);
+        uart_ring_pump(&rx);
+    }
+}
+
+static bool in_load_area(u64 addr, u64 len) {
+    return addr >= (u64)__load_start__ && addr + len <= (u64)__load_end__;
+}
+
+static void pump(void *ring) {
+    uart_ring_pump(ring);
+}
+
+static bool inflate(const u8 *src, u32 len) {
+    for (u32 off = 0; off < len; off += LZ4_SLICE) {
+        u32 n = len - off < LZ4_SLICE ? len - off : LZ4_SLICE;
+        if (!lz4_stream_feed(&lz, src + off, n))
+            return false;
+        uart_ring_pump(&rx);
+    }
+    return true;
+}
+
+// true if there was no block or it came out at the right size
+static bool inflate_close(void) {
+    if (!lz_open)
+        return true;
+    lz_open = false;
+    return lz4_stream_finish(&lz) == lz_size;
+}
+
+static void __attribute__((noreturn)) jump(u64 entry) {
+    irq_disable();
+    // the image went in through the D-cache
+    dcache_flush_all();
+    icache_flush_all();
+    asm volatile("fence.i");
+    ((void (*)(void))entry)();
+    __builtin_unreachable();
+}
+
+void kmain(void) {
+    uart_init(UART0, BOOT_BAUD);
+    uart_ring_init(&rx, UART0, rx_buf, sizeof(rx_buf));
+    uart_puts(UART0, "boot: ready\r\n");
+
+    struct boot_hdr h;
+    u16 expect = 0;
+    bool resync = false; // sent a NAK, waiting for expect to come back
+
+    while (1) {
+        if (!recv_frame(&h)) {
+            if (!resync)
+                reply(BOOT_NAK, expect);
+            resync = true;
+            continue;
+        }
+
+        if (h.type == BOOT_HELLO) {
+            // the host moves to the new rate on our ack, so refuse one
+            // we can't make before acking
+            struct uart_baud b;
+            if (h.addr && !uart_baud_calc(h.addr, &b)) {
+                reply(BOOT_ERR, h.seq);
+                continue;
+            }
+            expect = h.seq + 1;
+            resync = false;
+            lz_open = false;
+            reply(BOOT_ACK, expect);
+            if (h.addr) {
+                // let the ack drain at the old rate first
+                delay_ms(1);
+                uart_init(UART0, h.addr);
+            }
+            continue;
+        }
+
+        if (h.seq != expect) {
+            if ((i16)(h.seq - expect) < 0) {
+                // retransmit of something we already have
+                reply(BOOT_ACK, expect);
+            } else {
+                if (!resync)
+                    reply(BOOT_NAK, expect);
+                resync = true;
+            }
+            continue;
+        }
+        resync = false;
+
+        switch (h.type) {
+        case BOOT_DATA:
+            if (!in_load_area(h.addr, h.len)) {
+                reply(BOOT_ERR, h.seq);
+                break;
+            }
+            copy_out((u8 *)(u64)h.addr, chunk, h.len);
+            reply(BOOT_ACK, ++expect);
+            break;
+        case BOOT_INFLATE:
+            if (h.len != sizeof(lz_size) || !inflate_close()) {
+                reply(BOOT_ERR, h.seq);
+                break;
+            }
+            memcpy(&lz_size, chunk, sizeof(lz_size));
+            if (!in_load_area(h.addr, lz_size)) {
+                reply(BOOT_ERR, h.seq);
+                break;
+            }
+            lz4_stream_init(&lz, (void *)(u64)h.addr, lz_size);
+            // a single match can be as long as the block, pump inside it
+            lz4_stream_set_poll(&lz, pump, &rx);
+            lz_open = true;
+            reply(BOOT_ACK, ++expect);
+            break;
+        case BOOT_LZ4:
+            if (!lz_open || !inflate(chunk, h.len)) {
+                reply(BOOT_ERR, h.seq);
+                break;
+            }
+            reply(BOOT_ACK, ++expect);
+            break;
+        case BOOT_JUMP:
+            if (!inflate_close() || !in_load_area(h.addr, 4)) {
+                reply(BOOT_ERR, h.seq);
+                break;
+            }
+            reply(BOOT_ACK, ++expect);
+            delay_ms(1);
+            jump(h.addr);
+        default:
+            reply(BOOT_ERR, h.seq);
+            break;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// maximum square wave on one pin, old read-modify-write calls against
+// the write-only fast path, then four pins through the port registers.
+// put a scope on PIN to check the numbers.
+
+#define PIN      18
+#define PORT     ((1ULL << 18) | (1ULL << 19) | (1ULL << 20) | (1ULL << 21))
+#define NPERIODS (64 * 1024)
+
+static void put_rate(const char *label, uint64_t cycles) {
+    bench_put(UART0, label, cycles / NPERIODS, " cycles/period, ");
+    bench_put(UART0, "", cycle_cnt_hz() * NPERIODS / cycles,
+              " Hz\r\n");
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "gpio-bench\r\n");
+    bench_put(UART0, "cpu hz: ", cycle_cnt_calibrate(UART0, 115200), "\r\n");
+
+    gpio_set_output(PIN);
+
+    uint64_t start = cycle_cnt_read();
+    for (unsigned i = 0; i < NPERIODS; i++) {
+        gpio_set_on(PIN);
+        gpio_set_off(PIN);
+    }
+    put_rate("gpio_set_on/off:   ", cycle_cnt_read() - start);
+
+    start = cycle_cnt_read();
+    for (unsigned i = 0; i < NPERIODS; i++) {
+        gpio_write(PIN, 1);
+        gpio_write(PIN, 0);
+    }
+    put_rate("gpio_write:        ", cycle_cnt_read() - start);
+
+    gpio_fast_t p = gpio_fast_output(PIN);
+    start = cycle_cnt_read();
+    for (unsigned i = 0; i < NPERIODS; i++) {
+        gpio_fast_on(p);
+        gpio_fast_off(p);
+    }
+    put_rate("gpio_fast_on/off:  ", cycle_cnt_read() - start);
+
+    start = cycle_cnt_read();
+    for (unsigned i = 0; i < NPERIODS; i++) {
+        gpio_fast_set(PIN);
+        gpio_fast_clr(PIN);
+    }
+    put_rate("gpio_fast_set/clr: ", cycle_cnt_read() - start);
+
+    // four pins switching together, same cost as one
+    gpio_port_output(PORT);
+    start = cycle_cnt_read();
+    for (unsigned i = 0; i < NPERIODS; i++) {
+        gpio_port_write(PORT, PORT);
+        gpio_port_write(PORT, 0);
+    }
+    put_rate("gpio_port_write x4:", cycle_cnt_read() - start);
+
+    while (1)
+        asm volatile("wfi");
+}
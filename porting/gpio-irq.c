@@ -0,0 +1,74 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// gpio interrupts end to end. PIN is driven and watched at the same
+// time, so every toggle raises its own edge and we can time the path
+// from the store to the callback. BUTTON counts presses (to ground,
+// internal pull-up) with 20ms of debounce.
+
+#define PIN      18
+#define BUTTON   19
+#define NEDGES   1024
+
+static volatile uint64_t fired_at;
+static volatile unsigned presses;
+
+static void on_edge(unsigned pin, void *arg) {
+    fired_at = cycle_cnt_read();
+}
+
+static void on_press(unsigned pin, void *arg) {
+    presses++;
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "gpio-irq\r\n");
+
+    trap_init();
+    plic_init();
+
+    gpio_fast_t p = gpio_fast_output(PIN);
+    gpio_fast_off(p);
+    gpio_irq_attach(PIN, sync_both_edge, on_edge, 0);
+
+    gpio_set_pullup(BUTTON);
+    gpio_irq_attach(BUTTON, sync_fall_edge, on_press, 0);
+    gpio_irq_debounce(BUTTON, 20000);
+
+    irq_enable();
+
+    uint64_t min = ~0ULL, max = 0, sum = 0;
+    for (unsigned i = 0; i < NEDGES; i++) {
+        fired_at = 0;
+        uint64_t start = cycle_cnt_read();
+        gpio_fast_write(p, i & 1 ? 0 : 1);
+        while (!fired_at)
+            ;
+        uint64_t lat = fired_at - start;
+        min = lat < min ? lat : min;
+        max = lat > max ? lat : max;
+        sum += lat;
+    }
+
+    uart_puts(UART0, "edge to callback, cycles: min ");
+    uart_putdec(UART0, min);
+    uart_puts(UART0, " avg ");
+    uart_putdec(UART0, sum / NEDGES);
+    uart_puts(UART0, " max ");
+    uart_putdec(UART0, max);
+    uart_puts(UART0, "\r\n");
+
+    gpio_irq_detach(PIN);
+
+    unsigned seen = 0;
+    while (1) {
+        asm volatile("wfi");
+        if (presses != seen) {
+            seen = presses;
+            uart_puts(UART0, "presses: ");
+            uart_putdec(UART0, seen);
+            uart_puts(UART0, "\r\n");
+        }
+    }
+}
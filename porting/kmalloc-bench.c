@@ -0,0 +1,78 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// replays a pseudo-random alloc/free trace against kmalloc: a pool of
+// NSLOTS live pointers where each step frees a random slot (if full)
+// and refills it with a new allocation. sizes are skewed small the
+// way driver/request objects are, with the odd multi-page buffer.
+
+#define NSLOTS  1024
+#define NSTEPS  (256 * 1024)
+
+static void *slots[NSLOTS];
+static uint32_t seed = 12345;
+
+static uint32_t rand32(void) {
+    seed = seed * 1664525 + 1013904223;
+    return seed;
+}
+
+static size_t rand_size(void) {
+    uint32_t r = rand32();
+    switch (r >> 28) {
+    case 0:
+        return 2048 + (r >> 8) % 8192;    // large, page path
+    case 1: case 2: case 3:
+        return 256 + (r >> 8) % 1792;
+    default:
+        return 8 + (r >> 8) % 248;
+    }
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "kmalloc-bench\r\n");
+
+    kmalloc_init();
+
+    uint64_t fails = 0;
+    uint64_t start = cycle_cnt_read();
+    for (unsigned i = 0; i < NSTEPS; i++) {
+        unsigned s = rand32() % NSLOTS;
+        kfree(slots[s]);
+        slots[s] = kmalloc(rand_size());
+        if (!slots[s])
+            fails++;
+    }
+    uint64_t cycles = cycle_cnt_read() - start;
+
+    struct kmalloc_stats st;
+    kmalloc_get_stats(&st);
+
+    bench_put(UART0, "cycles per step:   ", cycles / NSTEPS, "\r\n");
+    bench_put(UART0, "failed allocs:     ", fails, "\r\n");
+    bench_put(UART0, "allocs:            ", st.nalloc, "\r\n");
+    bench_put(UART0, "frees:             ", st.nfree, "\r\n");
+    bench_put(UART0, "cache refills:     ", st.refills, "\r\n");
+    bench_put(UART0, "cache drains:      ", st.drains, "\r\n");
+    bench_put(UART0, "heap pages:        ", st.heap_pages, "\r\n");
+    bench_put(UART0, "pages used:        ", st.pages_used, "\r\n");
+    bench_put(UART0, "pages high-water:  ", st.pages_hwm, "\r\n");
+    bench_put(UART0, "large pages:       ", st.large_pages, "\r\n");
+    bench_put(UART0, "free runs:         ", st.free_runs, "\r\n");
+    bench_put(UART0, "free run pages:    ", st.free_pages, "\r\n");
+    bench_put(UART0, "largest free run:  ", st.largest_run, "\r\n");
+    bench_put(UART0, "fresh pages:       ", st.fresh_pages, "\r\n");
+    bench_put(UART0, "bad frees:         ", st.bad_frees, "\r\n");
+    // internal fragmentation from rounding up to a size class
+    bench_put(UART0, "internal frag x1000:",
+              1000 - st.bytes_requested * 1000 / st.bytes_allocated, "\r\n");
+    for (unsigned c = 0; c < KMALLOC_NCLASSES; c++) {
+        uart_puts(UART0, "  class ");
+        uart_putdec(UART0, 1 << (c + KMALLOC_MIN_SHIFT));
+        bench_put(UART0, " pages: ", st.class_pages[c], "\r\n");
+    }
+
+    while (1)
+        asm volatile("wfi");
+}
@@ -0,0 +1,62 @@
+#include "arena.h"
+#include "kmalloc.h"
+#include "string.h"
+#include "uart.h"
+
+static void arena_release(struct arena *a, char *to) {
+#ifdef ARENA_DEBUG
+  memset(to, ARENA_POISON, a->ptr - to);
+#endif
+  a->ptr = to;
+}
+
+void arena_init(struct arena *a, void *buf, size_t size) {
+  // keep the bump pointer aligned so arena_alloc only rounds the size
+  char *base = (char *)(((u64)buf + ARENA_ALIGN - 1) & ~(u64)(ARENA_ALIGN - 1));
+  size_t pad = base - (char *)buf;
+  size = size > pad ? size - pad : 0;
+
+  a->base = base;
+  a->ptr = base;
+  a->end = base + (size & ~(size_t)(ARENA_ALIGN - 1));
+  a->depth = 0;
+  a->npages = 0;
+}
+
+struct arena *arena_create(size_t size) {
+  // the header lives at the front of its own pages
+  unsigned npages = (sizeof(struct arena) + size + PAGE_SIZE - 1) / PAGE_SIZE;
+  struct arena *a = kpage_alloc(npages);
+  if (!a)
+    return 0;
+
+  arena_init(a, a + 1, (size_t)npages * PAGE_SIZE - sizeof(*a));
+  a->npages = npages;
+  return a;
+}
+
+void arena_destroy(struct arena *a) {
+  if (a->npages)
+    kpage_free(a, a->npages);
+}
+
+void arena_reset(struct arena *a) {
+  arena_release(a, a->base);
+  a->depth = 0;
+}
+
+struct arena_scope arena_scope_begin(struct arena *a) {
+  return (struct arena_scope){ .ptr = a->ptr, .depth = ++a->depth };
+}
+
+void arena_scope_end(struct arena *a, struct arena_scope s) {
+#ifdef ARENA_DEBUG
+  if (s.depth != a->depth) {
+    uart_puts(UART0, "arena: scope closed out of order\n");
+    while (1)
+      ;
+  }
+#endif
+  arena_release(a, s.ptr);
+  a->depth = s.depth - 1;
+}
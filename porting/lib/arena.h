@@ -0,0 +1,59 @@
+#pragma once
+
+#include "types.h"
+
+// bump-pointer arenas for allocate-many, free-all-at-once work.
+// arena_alloc is a round, a compare and an add; there is no per-object
+// free, arena_reset (or closing a scope) drops everything at once.
+//
+//   struct arena *a = arena_create(64 * 1024);
+//   struct arena_scope s = arena_scope_begin(a);
+//   req = arena_alloc(a, sizeof(*req));
+//   ...
+//   arena_scope_end(a, s); // everything since begin is gone
+//
+// build with -DARENA_DEBUG to poison released memory with
+// ARENA_POISON and catch out-of-order scope ends.
+
+#define ARENA_ALIGN  8
+#define ARENA_POISON 0xdb
+
+struct arena {
+  char *base;
+  char *ptr;
+  char *end;
+  unsigned depth; // open scopes
+  unsigned npages; // backing pages if we own them, else 0
+};
+
+struct arena_scope {
+  char *ptr;
+  unsigned depth;
+};
+
+// carve an arena out of the kmalloc page heap
+struct arena *arena_create(size_t size);
+void arena_destroy(struct arena *a);
+
+// or run one over memory the caller owns
+void arena_init(struct arena *a, void *buf, size_t size);
+
+void arena_reset(struct arena *a);
+
+struct arena_scope arena_scope_begin(struct arena *a);
+void arena_scope_end(struct arena *a, struct arena_scope s);
+
+static inline void *arena_alloc(struct arena *a, size_t size) {
+  char *p = a->ptr;
+  // compare before rounding so a huge size can't wrap to 0. ptr and end
+  // are both aligned, so a size that fits still fits rounded up
+  if (size > (size_t)(a->end - p))
+    return 0;
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  a->ptr = p + size;
+  return p;
+}
+
+static inline size_t arena_used(const struct arena *a) {
+  return a->ptr - a->base;
+}
@@ -0,0 +1,87 @@
+#include "async.h"
+#include "clint.h"
+#include "csr.h"
+#include "gpio.h"
+#include "uart.h"
+
+static struct async_task *tasks;
+static struct async_stats stats;
+
+void async_spawn(struct async_task *t, async_fn_t fn) {
+  t->fn = fn;
+  t->lc = 0;
+  t->wait = ASYNC_WAIT_NONE;
+  t->next = tasks;
+  tasks = t;
+}
+
+static bool can_resume(struct async_task *t, u64 now) {
+  switch (t->wait) {
+  case ASYNC_WAIT_TIME:
+    return (i64)(now - t->deadline) >= 0;
+  case ASYNC_WAIT_UART_RX:
+    return uart_can_getc(t->uart);
+  case ASYNC_WAIT_UART_TX:
+    return uart_can_putc(t->uart);
+  case ASYNC_WAIT_GPIO:
+    return gpio_read(t->pin) == t->level;
+  default:
+    return true;
+  }
+}
+
+bool async_poll(void) {
+  u64 now = clint_mtime();
+  struct async_task **pp = &tasks;
+
+  stats.passes++;
+  while (*pp) {
+    struct async_task *t = *pp;
+    if (can_resume(t, now)) {
+      stats.resumes++;
+      if (t->fn(t) == ASYNC_DONE) {
+        *pp = t->next;
+        continue;
+      }
+    }
+    pp = &t->next;
+  }
+  return tasks != 0;
+}
+
+// if every task is asleep on the clock, arm the CLINT for the earliest
+// deadline and wfi. MTIE is enabled with mstatus.MIE left off, so the
+// interrupt only wakes us and never traps. MTIE goes back to how we
+// found it so a later timer user doesn't inherit the enable.
+static void async_idle(void) {
+  u64 earliest = ~0ULL;
+
+  for (struct async_task *t = tasks; t; t = t->next) {
+    if (t->wait != ASYNC_WAIT_TIME)
+      return;
+    if (t->deadline < earliest)
+      earliest = t->deadline;
+  }
+  if ((i64)(earliest - clint_mtime()) <= 0)
+    return;
+
+  u64 flags = irq_save();
+  u64 mtie = csr_read(mie) & MIE_MTIE;
+  clint_set_timecmp(hart_id(), earliest);
+  csr_set(mie, MIE_MTIE);
+  asm volatile("wfi");
+  clint_timer_disarm();
+  if (!mtie)
+    csr_clear(mie, MIE_MTIE);
+  irq_restore(flags);
+  stats.sleeps++;
+}
+
+void async_run(void) {
+  while (async_poll())
+    async_idle();
+}
+
+const struct async_stats *async_get_stats(void) {
+  return &stats;
+}
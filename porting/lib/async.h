@@ -0,0 +1,126 @@
+#pragma once
+
+#include "clint.h"
+#include "types.h"
+#include "uart.h"
+
+// stackless coroutines (protothreads): a task is a function that is
+// re-entered from the top on every resume and jumps back to the line
+// it suspended on. nothing on the C stack survives an await, so keep
+// state in a struct that embeds the task (see async-echo.c).
+//
+//   static unsigned on;
+//   static int blink(struct async_task *t) {
+//     ASYNC_BEGIN(t);
+//     while (1) {
+//       gpio_write(16, on ^= 1);
+//       AWAIT_SLEEP_US(t, 500000);
+//     }
+//     ASYNC_END(t);
+//   }
+//
+// rules of thumb: no switch statements across an await, and only one
+// await per source line.
+
+enum {
+  ASYNC_WAITING = 0,
+  ASYNC_DONE = 1,
+};
+
+// what a suspended task is waiting for; the event loop checks this
+// itself and only resumes tasks that can make progress
+enum async_wait {
+  ASYNC_WAIT_NONE = 0, // plain yield, runnable next pass
+  ASYNC_WAIT_TIME,     // mtime >= deadline
+  ASYNC_WAIT_UART_RX,  // uart rx fifo non-empty
+  ASYNC_WAIT_UART_TX,  // uart tx fifo has room
+  ASYNC_WAIT_GPIO,     // gpio_read(pin) == level
+  ASYNC_WAIT_COND,     // re-run the task to re-test a condition
+};
+
+struct async_task;
+typedef int (*async_fn_t)(struct async_task *t);
+
+struct async_task {
+  async_fn_t fn;
+  struct async_task *next;
+  u16 lc;   // resume line, 0 == start
+  u8 wait;  // enum async_wait
+  u8 level; // for ASYNC_WAIT_GPIO
+  u32 pin;  // for ASYNC_WAIT_GPIO
+  union {
+    u64 deadline;               // for ASYNC_WAIT_TIME
+    volatile struct uart *uart; // for ASYNC_WAIT_UART_*
+  };
+};
+
+struct async_stats {
+  u64 passes;  // trips around the event loop
+  u64 resumes; // task function calls
+  u64 sleeps;  // times the loop parked in wfi
+};
+
+#define ASYNC_BEGIN(t) switch ((t)->lc) { case 0:
+
+#define ASYNC_END(t) \
+  } \
+  (t)->lc = 0; \
+  return ASYNC_DONE
+
+// record where to come back to, tell the loop what we wait on, leave
+#define ASYNC_SUSPEND_(t, kind) \
+  (t)->wait = (kind); \
+  (t)->lc = __LINE__; \
+  return ASYNC_WAITING; \
+  case __LINE__:;
+
+#define AWAIT_YIELD(t) do { ASYNC_SUSPEND_(t, ASYNC_WAIT_NONE); } while (0)
+
+#define AWAIT_UNTIL(t, cond) \
+  do { \
+    (t)->lc = __LINE__; \
+  case __LINE__: \
+    if (!(cond)) { \
+      (t)->wait = ASYNC_WAIT_COND; \
+      return ASYNC_WAITING; \
+    } \
+  } while (0)
+
+#define AWAIT_SLEEP_US(t, us) \
+  do { \
+    (t)->deadline = clint_mtime() + (u64)(us) * CLINT_TIMER_HZ / 1000000; \
+    ASYNC_SUSPEND_(t, ASYNC_WAIT_TIME); \
+  } while (0)
+
+#define AWAIT_UART_RX(t, u) \
+  do { \
+    (t)->uart = (u); \
+    ASYNC_SUSPEND_(t, ASYNC_WAIT_UART_RX); \
+  } while (0)
+
+#define AWAIT_UART_TX(t, u) \
+  do { \
+    (t)->uart = (u); \
+    ASYNC_SUSPEND_(t, ASYNC_WAIT_UART_TX); \
+  } while (0)
+
+#define AWAIT_GPIO(t, p, lvl) \
+  do { \
+    (t)->pin = (p); \
+    (t)->level = !!(lvl); \
+    ASYNC_SUSPEND_(t, ASYNC_WAIT_GPIO); \
+  } while (0)
+
+// the task struct is usually the first member of the caller's state
+#define async_container_of(ptr, type, member) \
+  ((type *)((char *)(ptr) - __builtin_offsetof(type, member)))
+
+void async_spawn(struct async_task *t, async_fn_t fn);
+
+// one pass over all tasks, returns false once every task is done
+bool async_poll(void);
+
+// run until every task is done; parks in wfi while everyone sleeps
+void async_run(void);
+
+const struct async_stats *async_get_stats(void);
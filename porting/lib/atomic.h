@@ -0,0 +1,140 @@
+#pragma once
+
+#include "types.h"
+
+// atomics on top of the RV64 A extension. the AMO forms are used
+// wherever one exists; compare-and-swap needs an lr/sc loop. every
+// read-modify-write here is fully ordered (.aqrl) unless the name
+// says otherwise.
+
+typedef struct {
+  volatile i32 counter;
+} atomic_t;
+
+typedef struct {
+  volatile i64 counter;
+} atomic64_t;
+
+#define ATOMIC_INIT(v) { (v) }
+
+#define smp_mb()  asm volatile("fence rw, rw" : : : "memory")
+#define smp_rmb() asm volatile("fence r, r" : : : "memory")
+#define smp_wmb() asm volatile("fence w, w" : : : "memory")
+
+// spin-wait hint; the C906 has no pause so just keep gcc honest
+#define cpu_relax() asm volatile("" : : : "memory")
+
+static inline i32 atomic_read(const atomic_t *a) {
+  return a->counter;
+}
+
+static inline void atomic_set(atomic_t *a, i32 v) {
+  a->counter = v;
+}
+
+static inline i32 atomic_fetch_add(atomic_t *a, i32 v) {
+  i32 old;
+  asm volatile("amoadd.w.aqrl %0, %2, %1"
+               : "=r"(old), "+A"(a->counter)
+               : "r"(v)
+               : "memory");
+  return old;
+}
+
+static inline i32 atomic_add_return(atomic_t *a, i32 v) {
+  return atomic_fetch_add(a, v) + v;
+}
+
+static inline void atomic_inc(atomic_t *a) {
+  atomic_fetch_add(a, 1);
+}
+
+static inline void atomic_dec(atomic_t *a) {
+  atomic_fetch_add(a, -1);
+}
+
+static inline i32 atomic_fetch_or(atomic_t *a, i32 v) {
+  i32 old;
+  asm volatile("amoor.w.aqrl %0, %2, %1"
+               : "=r"(old), "+A"(a->counter)
+               : "r"(v)
+               : "memory");
+  return old;
+}
+
+static inline i32 atomic_fetch_and(atomic_t *a, i32 v) {
+  i32 old;
+  asm volatile("amoand.w.aqrl %0, %2, %1"
+               : "=r"(old), "+A"(a->counter)
+               : "r"(v)
+               : "memory");
+  return old;
+}
+
+static inline i32 atomic_xchg(atomic_t *a, i32 v) {
+  i32 old;
+  asm volatile("amoswap.w.aqrl %0, %2, %1"
+               : "=r"(old), "+A"(a->counter)
+               : "r"(v)
+               : "memory");
+  return old;
+}
+
+// returns the value seen; the swap happened iff that equals expected
+static inline i32 atomic_cmpxchg(atomic_t *a, i32 expected, i32 desired) {
+  i32 old;
+  u32 fail;
+  asm volatile("1: lr.w.aqrl %0, %2\n"
+               "   bne %0, %3, 2f\n"
+               "   sc.w.aqrl %1, %4, %2\n"
+               "   bnez %1, 1b\n"
+               "2:"
+               : "=&r"(old), "=&r"(fail), "+A"(a->counter)
+               : "r"(expected), "r"(desired)
+               : "memory");
+  return old;
+}
+
+static inline i64 atomic64_read(const atomic64_t *a) {
+  return a->counter;
+}
+
+static inline void atomic64_set(atomic64_t *a, i64 v) {
+  a->counter = v;
+}
+
+static inline i64 atomic64_fetch_add(atomic64_t *a, i64 v) {
+  i64 old;
+  asm volatile("amoadd.d.aqrl %0, %2, %1"
+               : "=r"(old), "+A"(a->counter)
+               : "r"(v)
+               : "memory");
+  return old;
+}
+
+static inline i64 atomic64_add_return(atomic64_t *a, i64 v) {
+  return atomic64_fetch_add(a, v) + v;
+}
+
+static inline i64 atomic64_xchg(atomic64_t *a, i64 v) {
+  i64 old;
+  asm volatile("amoswap.d.aqrl %0, %2, %1"
+               : "=r"(old), "+A"(a->counter)
+               : "r"(v)
+               : "memory");
+  return old;
+}
+
+static inline i64 atomic64_cmpxchg(atomic64_t *a, i64 expected, i64 desired) {
+  i64 old;
+  u64 fail;
+  asm volatile("1: lr.d.aqrl %0, %2\n"
+               "   bne %0, %3, 2f\n"
+               "   sc.d.aqrl %1, %4, %2\n"
+               "   bnez %1, 1b\n"
+               "2:"
+               : "=&r"(old), "=&r"(fail), "+A"(a->counter)
+               : "r"(expected), "r"(desired)
+               : "memory");
+  return old;
+}
@@ -0,0 +1,172 @@
+#include "bench.h"
+#include "cache.h"
+#include "csr.h"
+#include "cycle-counter.h"
+
+extern const struct bench __bench_start[], __bench_end[];
+
+static u64 samples[BENCH_MAX_REPS];
+static u64 overhead;
+
+static void bench_empty(void) {
+}
+
+// interrupts off, one call, rdcycle on either side
+static u64 time_one(void (*fn)(void), unsigned flags) {
+  if (flags & BENCH_FLUSH) {
+    dcache_flush_all();
+    icache_flush_all();
+  }
+
+  u64 irq = irq_save();
+  u64 start = cycle_cnt_read();
+  fn();
+  u64 d = cycle_cnt_read() - start;
+  irq_restore(irq);
+  return d;
+}
+
+// the smallest delta an empty call gives, taken off every sample
+static void calibrate(void) {
+  overhead = ~0ULL;
+  for (unsigned i = 0; i < 64; i++) {
+    u64 d = time_one(bench_empty, 0);
+    if (d < overhead)
+      overhead = d;
+  }
+}
+
+// shell sort, the sample count is small and this runs outside timing
+static void sort(u64 *a, unsigned n) {
+  for (unsigned gap = n / 2; gap; gap /= 2) {
+    for (unsigned i = gap; i < n; i++) {
+      u64 v = a[i];
+      unsigned j = i;
+      for (; j >= gap && a[j - gap] > v; j -= gap)
+        a[j] = a[j - gap];
+      a[j] = v;
+    }
+  }
+}
+
+// no FP here (mstatus.FS is off)
+static u64 isqrt(u64 x) {
+  u64 r = 0;
+  for (u64 bit = 1ULL << 62; bit; bit >>= 2) {
+    if (x >= r + bit) {
+      x -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+  }
+  return r;
+}
+
+void bench_run(const struct bench *b, const struct bench_opts *o,
+               struct bench_result *r) {
+  unsigned flags = b->flags | o->flags;
+  unsigned n = o->reps;
+  if (n > BENCH_MAX_REPS)
+    n = BENCH_MAX_REPS;
+  if (n == 0)
+    n = 1;
+
+  if (!overhead)
+    calibrate();
+
+  for (unsigned i = 0; i < o->warmup; i++)
+    b->fn();
+
+  u64 sum = 0;
+  for (unsigned i = 0; i < n; i++) {
+    u64 d = time_one(b->fn, flags);
+    d = d > overhead ? d - overhead : 0;
+    samples[i] = d;
+    sum += d;
+  }
+
+  u64 mean = sum / n;
+  u64 var = 0;
+  for (unsigned i = 0; i < n; i++) {
+    u64 dev = samples[i] > mean ? samples[i] - mean : mean - samples[i];
+    var += dev * dev;
+  }
+
+  sort(samples, n);
+  r->n = n;
+  r->min = samples[0];
+  r->median = samples[n / 2];
+  r->p99 = samples[(n * 99 + 99) / 100 - 1];
+  r->max = samples[n - 1];
+  r->mean = mean;
+  r->stddev = isqrt(var / n);
+}
+
+static void put_field(volatile struct uart *uart, const char *key, u64 v) {
+  uart_putc(uart, ' ');
+  uart_puts(uart, key);
+  uart_putc(uart, '=');
+  uart_putdec(uart, v);
+}
+
+void bench_report(volatile struct uart *uart, const struct bench *b,
+                  const struct bench_opts *o, const struct bench_result *r) {
+  uart_puts(uart, "BENCH name=");
+  uart_puts(uart, b->name);
+  put_field(uart, "n", r->n);
+  put_field(uart, "min", r->min);
+  put_field(uart, "median", r->median);
+  put_field(uart, "p99", r->p99);
+  put_field(uart, "max", r->max);
+  put_field(uart, "mean", r->mean);
+  put_field(uart, "stddev", r->stddev);
+  put_field(uart, "flags", b->flags | o->flags);
+  uart_puts(uart, "\r\n");
+}
+
+unsigned bench_run_all(volatile struct uart *uart, const struct bench_opts *o) {
+  struct bench_result r;
+  unsigned n = 0;
+
+  for (const struct bench *b = __bench_start; b < __bench_end; b++) {
+    bench_run(b, o, &r);
+    bench_report(uart, b, o, &r);
+    n++;
+  }
+  return n;
+}
+
+static void put_signed(volatile struct uart *uart, i64 val) {
+  if (val < 0) {
+    uart_putc(uart, '-');
+    val = -val;
+  }
+  uart_putdec(uart, val);
+}
+
+void bench_put(volatile struct uart *uart, const char *label, i64 val,
+               const char *unit) {
+  uart_puts(uart, label);
+  put_signed(uart, val);
+  uart_puts(uart, unit);
+}
+
+void bench_put_tenths(volatile struct uart *uart, const char *label,
+                      i64 tenths, const char *unit) {
+  uart_puts(uart, label);
+  if (tenths < 0) {
+    uart_putc(uart, '-');
+    tenths = -tenths;
+  }
+  uart_putdec(uart, tenths / 10);
+  uart_putc(uart, '.');
+  uart_putdec(uart, tenths % 10);
+  uart_puts(uart, unit);
+}
+
+void bench_put_cycles(volatile struct uart *uart, const char *label,
+                      i64 cycles) {
+  bench_put(uart, label, cycles, " cycles (");
+  bench_put(uart, "", cycles * 1000000000 / (i64)cycle_cnt_hz(), " ns)\r\n");
+}
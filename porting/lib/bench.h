@@ -0,0 +1,73 @@
+#pragma once
+
+#include "types.h"
+#include "uart.h"
+
+// on-target microbenchmarks. define one anywhere in a payload with
+//
+//   BENCH(crc32_1k) { crc32(buf, 1024); }
+//
+// and the linker collects it into the .bench table (memmap.ld).
+// bench_run_all runs every entry: a few warmup calls, then `reps`
+// timed calls, each one its own rdcycle delta with the cost of the
+// timing itself taken off. BENCH_FLUSH writes back and invalidates
+// both caches before every call, for cold numbers.
+//
+// results go out one line per benchmark, for tools/bench-diff.py:
+//   BENCH name=crc32_1k n=256 min=.. median=.. p99=.. max=.. mean=.. stddev=.. flags=0
+// all in cycles. interrupts are off around every call.
+
+#define BENCH_MAX_REPS 1024
+#define BENCH_FLUSH    1
+
+struct bench {
+  const char *name;
+  void (*fn)(void);
+  unsigned flags;
+};
+
+#define BENCH_FLAGS(id, fl)                                                \
+  static void bench_fn_##id(void);                                         \
+  static const struct bench bench_##id                                     \
+      __attribute__((used, section(".bench"), aligned(8))) = {             \
+          #id, bench_fn_##id, (fl)};                                       \
+  static void bench_fn_##id(void)
+
+#define BENCH(id) BENCH_FLAGS(id, 0)
+
+struct bench_opts {
+  unsigned warmup;
+  unsigned reps;  // capped at BENCH_MAX_REPS
+  unsigned flags; // or'd into every benchmark's own flags
+};
+
+#define BENCH_OPTS_DEFAULT { .warmup = 8, .reps = 256, .flags = 0 }
+
+struct bench_result {
+  u64 n;
+  u64 min;
+  u64 median;
+  u64 p99;
+  u64 max;
+  u64 mean;
+  u64 stddev;
+};
+
+void bench_run(const struct bench *b, const struct bench_opts *o,
+               struct bench_result *r);
+void bench_report(volatile struct uart *uart, const struct bench *b,
+                  const struct bench_opts *o, const struct bench_result *r);
+
+// returns how many ran
+unsigned bench_run_all(volatile struct uart *uart, const struct bench_opts *o);
+
+// the payloads' own result tables: label, val, then unit (which
+// carries the line end when there is one)
+void bench_put(volatile struct uart *uart, const char *label, i64 val,
+               const char *unit);
+// val in tenths, "12.3"
+void bench_put_tenths(volatile struct uart *uart, const char *label,
+                      i64 tenths, const char *unit);
+// "label N cycles (M ns)" and a line end, at cycle_cnt_hz()
+void bench_put_cycles(volatile struct uart *uart, const char *label,
+                      i64 cycles);
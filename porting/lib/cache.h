@@ -0,0 +1,25 @@
+#pragma once
+
+// whole-cache maintenance through the C906 (T-Head) extension
+// instructions. the assembler doesn't know them, hence the raw
+// encodings. they are only legal with mxstatus.THEADISAEE (bit 22) set,
+// so turn that on first.
+#define MXSTATUS_THEADISAEE (1UL << 22)
+
+static inline void thead_isa_enable(void) {
+  asm volatile("csrs 0x7c0, %0" : : "r"(MXSTATUS_THEADISAEE));
+}
+
+// dcache.ciall: write back and invalidate the whole D-cache
+static inline void dcache_flush_all(void) {
+  thead_isa_enable();
+  asm volatile(".long 0x0030000b" : : : "memory");
+  asm volatile(".long 0x0190000b" : : : "memory"); // sync.s
+}
+
+// icache.iall: invalidate the whole I-cache
+static inline void icache_flush_all(void) {
+  thead_isa_enable();
+  asm volatile(".long 0x0100000b" : : : "memory");
+  asm volatile(".long 0x0190000b" : : : "memory"); // sync.s
+}
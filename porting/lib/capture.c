@@ -0,0 +1,111 @@
+#include "capture.h"
+#include "atomic.h"
+#include "crc32.h"
+#include "cycle-counter.h"
+#include "gpio.h"
+#include "sections.h"
+
+// one block never holds more than this, so the host can resync fast
+#define BLOCK_MAX 256
+
+static capture_edge_t *ring __fast_bss;
+static u32 mask __fast_bss;
+static volatile u32 head __fast_bss; // written by the interrupt only
+static volatile u32 tail __fast_bss; // written by the reader only
+static volatile u32 dropped __fast_bss;
+static u64 pins;
+
+__hot_text static void on_edge(unsigned pin, void *arg) {
+  u64 now = cycle_cnt_read();
+  unsigned level = (GPIO_IN[pin >> 5] >> (pin & 31)) & 1;
+
+  u32 h = head;
+  if (h - tail > mask) {
+    dropped++;
+    return;
+  }
+  ring[h & mask] = now << 8 | level << 7 | pin;
+  // the entry has to be visible before the reader sees the new head
+  smp_wmb();
+  head = h + 1;
+}
+
+void capture_init(capture_edge_t *buf, u32 n) {
+  ring = buf;
+  mask = n - 1;
+  head = tail = 0;
+  dropped = 0;
+}
+
+void capture_start(u64 pin_mask) {
+  pins = pin_mask;
+  for (u64 m = pin_mask; m; m &= m - 1)
+    gpio_irq_attach(__builtin_ctzll(m), sync_both_edge, on_edge, 0);
+}
+
+void capture_stop(void) {
+  for (u64 m = pins; m; m &= m - 1)
+    gpio_irq_detach(__builtin_ctzll(m));
+}
+
+u32 capture_count(void) {
+  return head - tail;
+}
+
+u32 capture_dropped(void) {
+  return dropped;
+}
+
+bool capture_get(capture_edge_t *e) {
+  u32 t = tail;
+  if (head == t)
+    return false;
+  smp_rmb();
+  *e = ring[t & mask];
+  tail = t + 1;
+  return true;
+}
+
+static void put_u32(volatile struct uart *uart, u32 v) {
+  for (unsigned i = 0; i < 4; i++)
+    uart_putc(uart, v >> (8 * i));
+}
+
+void capture_stream_begin(volatile struct uart *uart) {
+  put_u32(uart, CAPTURE_MAGIC);
+  put_u32(uart, CAPTURE_VERSION);
+  put_u32(uart, cycle_cnt_hz());
+  put_u32(uart, pins);
+  put_u32(uart, pins >> 32);
+}
+
+static void put_block(volatile struct uart *uart, u32 n) {
+  u32 crc = 0;
+
+  put_u32(uart, n);
+  put_u32(uart, dropped);
+  for (u32 i = 0; i < n; i++) {
+    capture_edge_t e;
+    capture_get(&e);
+    put_u32(uart, e);
+    put_u32(uart, e >> 32);
+    crc = crc32_inc(&e, sizeof(e), crc);
+  }
+  put_u32(uart, crc);
+}
+
+u32 capture_stream_pump(volatile struct uart *uart) {
+  u32 n = capture_count();
+  if (n == 0)
+    return 0;
+  if (n > BLOCK_MAX)
+    n = BLOCK_MAX;
+  put_block(uart, n);
+  return n;
+}
+
+void capture_stream_end(volatile struct uart *uart) {
+  while (capture_stream_pump(uart))
+    ;
+  put_block(uart, 0);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "types.h"
+#include "uart.h"
+
+// gpio logic analyzer. every edge on a captured pin is timestamped with
+// rdcycle in the gpio interrupt and pushed into a caller supplied ring.
+// the interrupt is the only writer and the consumer the only reader,
+// so the ring needs no lock; when it is full new edges are counted as
+// dropped instead of overwriting old ones.
+//
+// needs trap_init, plic_init and interrupts on, like gpio_irq_attach.
+// timestamps carry the interrupt latency as a near constant offset
+// (see gpio-irq.c), so edge to edge times are good to a few cycles
+// as long as edges don't come faster than the handler.
+//
+// stream format, all little endian:
+//   u32 magic, u32 version, u32 cycles per second, u64 pin mask,
+//   then blocks of: u32 n, u32 dropped so far, n x u64 edge, u32 crc32
+//   of the edge words. a block with n = 0 ends the stream.
+// an edge word is cycles << 8 | level << 7 | pin.
+
+#define CAPTURE_MAGIC   0x54504143 // "CAPT"
+#define CAPTURE_VERSION 1
+
+typedef u64 capture_edge_t;
+
+#define CAPTURE_PIN(e)    ((unsigned)((e) & 0x3f))
+#define CAPTURE_LEVEL(e)  ((unsigned)((e) >> 7) & 1)
+#define CAPTURE_CYCLES(e) ((e) >> 8)
+
+// n must be a power of two
+void capture_init(capture_edge_t *buf, u32 n);
+
+// attach every pin in mask (bit n = pin n) on both edges
+void capture_start(u64 pins);
+void capture_stop(void);
+
+u32 capture_count(void);
+u32 capture_dropped(void);
+bool capture_get(capture_edge_t *e);
+
+// the header, then one block per pump with whatever is in the ring,
+// then the terminating block. pump in a loop for as long as you want
+// to record; the edges keep landing in the ring while it sends
+void capture_stream_begin(volatile struct uart *uart);
+u32 capture_stream_pump(volatile struct uart *uart);
+void capture_stream_end(volatile struct uart *uart);
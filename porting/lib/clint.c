@@ -0,0 +1,52 @@
+#include "clint.h"
+#include "csr.h"
+#include "memory.h"
+#include "sections.h"
+#include "timer.h"
+
+static volatile u32 *msip_reg(unsigned hart) {
+  return (volatile u32 *)(CLINT_MSIP_BASE + 4 * hart);
+}
+
+static volatile u32 *mtimecmp_reg(unsigned hart) {
+  return (volatile u32 *)(CLINT_MTIMECMP_BASE + 8 * hart);
+}
+
+void clint_init(void) {
+  timer_init(CLINT_TIMER_HZ);
+  clint_timer_disarm();
+  clint_clear_ipi(hart_id());
+}
+
+__hot_text u64 clint_mtime(void) {
+  return timer_read();
+}
+
+__hot_text void clint_set_timecmp(unsigned hart, u64 when) {
+  volatile u32 *cmp = mtimecmp_reg(hart);
+
+  // the compare register is written as two halves, so park the high
+  // word at the max first or we can fire on a half-updated value
+  put32(cmp + 1, 0xffffffff);
+  put32(cmp, (u32)when);
+  put32(cmp + 1, (u32)(when >> 32));
+}
+
+// fire the timer interrupt delta ticks from now, returns the deadline
+u64 clint_timer_arm(u64 delta) {
+  u64 when = clint_mtime() + delta;
+  clint_set_timecmp(hart_id(), when);
+  return when;
+}
+
+void clint_timer_disarm(void) {
+  clint_set_timecmp(hart_id(), ~0ULL);
+}
+
+void clint_send_ipi(unsigned hart) {
+  put32(msip_reg(hart), 1);
+}
+
+void clint_clear_ipi(unsigned hart) {
+  put32(msip_reg(hart), 0);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "types.h"
+
+// CLINT lives at mapbaddr (0xe0000000) + 0x4000000, see the README
+// and c906 pg 84. each hart gets its own msip word and mtimecmp pair.
+#define CLINT_MSIP_BASE     0xe4000000UL
+#define CLINT_MTIMECMP_BASE 0xe4004000UL
+
+// we program the mtime divider so one tick is one microsecond
+#define CLINT_TIMER_HZ      1000000
+
+void clint_init(void);
+
+u64 clint_mtime(void);
+void clint_set_timecmp(unsigned hart, u64 when);
+u64 clint_timer_arm(u64 delta);
+void clint_timer_disarm(void);
+
+void clint_send_ipi(unsigned hart);
+void clint_clear_ipi(unsigned hart);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "types.h"
+
+// mstatus bits, c906 pg 618-621
+#define MSTATUS_MIE   (1UL << 3)
+#define MSTATUS_MPIE  (1UL << 7)
+#define MSTATUS_MPP   (3UL << 11)
+
+// machine interrupt numbers (mcause with the top bit cleared)
+// these are also the bit positions in mie/mip, c906 pg 623-628
+#define IRQ_M_SOFT    3
+#define IRQ_M_TIMER   7
+#define IRQ_M_EXT     11
+
+#define MIE_MSIE      (1UL << IRQ_M_SOFT)
+#define MIE_MTIE      (1UL << IRQ_M_TIMER)
+#define MIE_MEIE      (1UL << IRQ_M_EXT)
+
+// exception codes we care about, c906 pg 626
+#define EXC_ECALL_M   11
+
+#define csr_read(csr) \
+  ({ \
+    u64 __v; \
+    asm volatile("csrr %0, " #csr : "=r"(__v)); \
+    __v; \
+  })
+
+#define csr_write(csr, val) \
+  asm volatile("csrw " #csr ", %0" : : "rK"((u64)(val)) : "memory")
+
+#define csr_set(csr, bits) \
+  asm volatile("csrs " #csr ", %0" : : "rK"((u64)(bits)) : "memory")
+
+#define csr_clear(csr, bits) \
+  asm volatile("csrc " #csr ", %0" : : "rK"((u64)(bits)) : "memory")
+
+static inline unsigned hart_id(void) {
+  return csr_read(mhartid);
+}
+
+// these are named irq_* so they don't collide with the
+// disable_interrupts/enable_interrupts copies in the payloads;
+// they touch the same mstatus.MIE bit
+static inline void irq_disable(void) {
+  asm volatile("csrci mstatus, 0x8" : : : "memory");
+}
+
+static inline void irq_enable(void) {
+  asm volatile("csrsi mstatus, 0x8" : : : "memory");
+}
+
+// clear MIE and return whether it was set before
+static inline u64 irq_save(void) {
+  u64 flags;
+  asm volatile("csrrci %0, mstatus, 0x8" : "=r"(flags) : : "memory");
+  return flags & MSTATUS_MIE;
+}
+
+static inline void irq_restore(u64 flags) {
+  asm volatile("csrs mstatus, %0" : : "r"(flags) : "memory");
+}
@@ -1,16 +1,50 @@
+#include "cycle-counter.h"
+#include "trace.h"
+#include "types.h"
 #include "uart.h"
 
+// all sections below are 8 byte aligned at both ends (memmap.ld), so
+// copy a doubleword at a time. with XIP the source is flash and every
+// load is a trip through the flash cache
+static void copy_section(u64 *dst, const u64 *src, const u64 *end) {
+  // linked for where it was loaded, nothing to do
+  if (dst == src)
+    return;
+  while (dst < end)
+    *dst++ = *src++;
+}
+
+static void zero_section(u64 *dst, const u64 *end) {
+  while (dst < end)
+    *dst++ = 0;
+}
+
 void _cstart(void) {
-  extern char _kdata_start[], _kdata_start_load[], _kdata_end[];
-  extern char _kbss_start[], _kbss_end[];
+#ifdef TRACE
+  u64 boot = cycle_cnt_read();
+#endif
+  extern u64 _kdata_start[], _kdata_start_load[], _kdata_end[];
+  extern u64 _kbss_start[], _kbss_end[];
+
+  copy_section(_kdata_start, _kdata_start_load, _kdata_end);
+  zero_section(_kbss_start, _kbss_end);
+
+  // hot code/data live in WRAM but are loaded behind .data
+  extern u64 _khot_text_start[], _khot_text_start_load[], _khot_text_end[];
+  extern u64 _kfast_data_start[], _kfast_data_start_load[], _kfast_data_end[];
+  extern u64 _kfast_bss_start[], _kfast_bss_end[];
+
+  copy_section(_khot_text_start, _khot_text_start_load, _khot_text_end);
+  copy_section(_kfast_data_start, _kfast_data_start_load, _kfast_data_end);
+  zero_section(_kfast_bss_start, _kfast_bss_end);
 
-  for (char *s = _kdata_start, *d = _kdata_start_load; s < _kdata_end; s++, d++) {
-    *s = *d;
-  }
+  // we just wrote instructions through the D-side
+  asm volatile("fence.i");
 
-  for (char *s = _kbss_start; s < _kbss_end; s++) {
-    *s = 0;
-  }
+#ifdef TRACE
+  // the ring only exists now, log our entry after the fact
+  trace_log(_cstart, false, boot);
+#endif
 
   void kmain(void);
   kmain();
@@ -0,0 +1,37 @@
+#include "cycle-counter.h"
+#include "csr.h"
+#include "uart.h"
+
+// 8N1, start + 8 data + stop
+#define FRAME_BITS 10
+#define NFRAMES    48
+
+static uint64_t hz = CYCLES_PER_SECOND;
+
+uint64_t cycle_cnt_hz(void) {
+  return hz;
+}
+
+uint64_t cycle_cnt_calibrate(volatile struct uart *uart, unsigned baud) {
+  u64 flags = irq_save();
+
+  // keep the fifo topped up so the shifter never idles; then a slot
+  // frees up exactly once per frame
+  while (uart_can_putc(uart))
+    uart_putc(uart, 0);
+
+  uint64_t t0 = 0, t = 0;
+  for (unsigned i = 0; i <= NFRAMES; i++) {
+    while (uart_tx_free(uart) == 0)
+      ;
+    t = cycle_cnt_read();
+    if (i == 0)
+      t0 = t;
+    uart_putc(uart, 0);
+  }
+  irq_restore(flags);
+  uint64_t cycles = t - t0;
+
+  hz = cycles * baud / (NFRAMES * FRAME_BITS);
+  return hz;
+}
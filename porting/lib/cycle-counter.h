@@ -1,8 +1,20 @@
 #pragma once
 #include <stddef.h>
+#include <stdint.h>
 
 #define CYCLES_PER_SECOND 320000000
 
+struct uart;
+
+// rdcycle ticks per second: CYCLES_PER_SECOND until
+// cycle_cnt_calibrate has measured the real thing
+uint64_t cycle_cnt_hz(void);
+
+// times a run of frames on a uart that is known to be at baud (the
+// console), sending NULs, and keeps the result for cycle_cnt_hz.
+// takes about 80 character times
+uint64_t cycle_cnt_calibrate(volatile struct uart *uart, unsigned baud);
+
 static size_t cycle_cnt_read(void) {
   size_t count;
   asm volatile("rdcycle %0" : "=r"(count));
@@ -12,7 +12,7 @@ static void delay_ncycles(size_t ncycles) {
 }
 
 static void delay_us(size_t us) {
-  delay_ncycles(CYCLES_PER_SECOND / 1000000 * us);
+  delay_ncycles(cycle_cnt_hz() / 1000000 * us);
 }
 
 static void delay_ms(size_t ms) {
@@ -25,5 +25,5 @@ static void delay_sec(size_t sec) {
 
 // get elapsed usec since cnt cycles
 static unsigned timer_get_usec() {
-  return (cycle_cnt_read() * 1000000) / CYCLES_PER_SECOND;
+  return (cycle_cnt_read() * 1000000) / cycle_cnt_hz();
 }
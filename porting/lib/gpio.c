@@ -1,4 +1,24 @@
 #include "gpio.h"
+#include "csr.h"
+#include "cycle-counter.h"
+#include "sections.h"
+
+// raw config words and the interrupt bits in them, for the handler
+#define CFG_RAW         ((volatile uint32_t *)GPIO_CFG0)
+#define CFG_INT_CLR     (1U << 20)
+#define CFG_INT_STAT    (1U << 21)
+#define CFG_SET         (1U << 25)
+#define CFG_CLR         (1U << 26)
+
+struct pin_irq {
+    gpio_irq_fn_t fn;
+    void *arg;
+    uint64_t debounce;  // cycles, 0 = off
+    uint64_t last;      // rdcycle of the last edge passed on
+};
+
+static struct pin_irq pin_irqs[GPIO_NPINS] __fast_bss;
+static uint64_t irq_attached __fast_bss;
 
 void gpio_set_function(unsigned pin, gpio_func_t function) {
     gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
@@ -64,3 +84,191 @@ void gpio_set_off(unsigned pin) {
     cfg.clr = 1;
     put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
 }
+
+void gpio_set_pullup(unsigned pin) {
+    gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+    cfg.pu_control = 1;
+    cfg.pd_control = 0;
+    cfg.set = 0;
+    cfg.clr = 0;
+    put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+}
+
+void gpio_set_pulldown(unsigned pin) {
+    gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+    cfg.pu_control = 0;
+    cfg.pd_control = 1;
+    cfg.set = 0;
+    cfg.clr = 0;
+    put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+}
+
+void gpio_pud_off(unsigned pin) {
+    gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+    cfg.pu_control = 0;
+    cfg.pd_control = 0;
+    cfg.set = 0;
+    cfg.clr = 0;
+    put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+}
+
+// 1 pull-up, 0 pull-down, -1 neither
+int gpio_get_pud(unsigned pin) {
+    gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+    if (cfg.pu_control)
+        return 1;
+    if (cfg.pd_control)
+        return 0;
+    return -1;
+}
+
+gpio_fast_t gpio_fast_output(unsigned pin) {
+    // read the word back every time: any other setter may have changed
+    // it since the last call
+    gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+    cfg.output_enable = 1;
+    cfg.func_sel = GPIO_FUNC_GPIO;
+    cfg.mode = set_clr_mode;
+    // the set/clr bits in here are write-1 strobes, don't replay them
+    cfg.set = 0;
+    cfg.clr = 0;
+    put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+
+    return (gpio_fast_t){
+        .set = &GPIO_SET[pin >> 5],
+        .clr = &GPIO_CLR[pin >> 5],
+        .mask = 1U << (pin & 31),
+    };
+}
+
+void gpio_port_output(uint64_t mask) {
+    for (unsigned pin = 0; pin < GPIO_NPINS; pin++) {
+        if (!(mask & (1ULL << pin)))
+            continue;
+        gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+        cfg.output_enable = 1;
+        cfg.func_sel = GPIO_FUNC_GPIO;
+        cfg.mode = op_val_mode;
+        cfg.set = 0;
+        cfg.clr = 0;
+        put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+    }
+}
+
+void gpio_port_input(uint64_t mask) {
+    for (unsigned pin = 0; pin < GPIO_NPINS; pin++) {
+        if (!(mask & (1ULL << pin)))
+            continue;
+        gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+        cfg.input_enable = 1;
+        cfg.output_enable = 0;
+        cfg.func_sel = GPIO_FUNC_GPIO;
+        put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+    }
+}
+
+__hot_text void gpio_port_write(uint64_t mask, uint64_t values) {
+    // read-modify-write of the live word, so pins outside the mask keep
+    // whatever anyone else last drove on them. irqs off so a handler
+    // writing the port can't land between the read and the store
+    uint64_t flags = irq_save();
+    for (unsigned w = 0; w < 2; w++) {
+        uint32_t m = mask >> (32 * w);
+        if (!m)
+            continue;
+        uint32_t v = values >> (32 * w);
+        GPIO_OUT[w] = (GPIO_OUT[w] & ~m) | (v & m);
+    }
+    irq_restore(flags);
+}
+
+__hot_text uint64_t gpio_port_read(uint64_t mask) {
+    uint64_t v = 0;
+    if ((uint32_t)mask)
+        v |= GPIO_IN[0];
+    if (mask >> 32)
+        v |= (uint64_t)GPIO_IN[1] << 32;
+    return v & mask;
+}
+
+__hot_text static void gpio_irq_dispatch(unsigned irq, void *arg) {
+    // one status bit per config word, so gather them first and then
+    // walk only the pins that fired
+    uint64_t pending = 0;
+    for (uint64_t m = irq_attached; m; m &= m - 1) {
+        unsigned pin = __builtin_ctzll(m);
+        if (CFG_RAW[pin] & CFG_INT_STAT)
+            pending |= 1ULL << pin;
+    }
+
+    uint64_t now = cycle_cnt_read();
+    for (; pending; pending &= pending - 1) {
+        unsigned pin = __builtin_ctzll(pending);
+        struct pin_irq *p = &pin_irqs[pin];
+
+        // int_clr has to go 1 then 0 again or the next edge is lost.
+        // set/clr are strobes, never write them back
+        uint32_t cfg = CFG_RAW[pin] & ~(CFG_SET | CFG_CLR);
+        CFG_RAW[pin] = cfg | CFG_INT_CLR;
+        CFG_RAW[pin] = cfg & ~CFG_INT_CLR;
+
+        if (p->debounce && now - p->last < p->debounce)
+            continue;
+        p->last = now;
+        p->fn(pin, p->arg);
+    }
+}
+
+void gpio_irq_attach(unsigned pin, unsigned mode, gpio_irq_fn_t fn, void *arg) {
+    if (pin >= GPIO_NPINS || !fn)
+        return;
+
+    uint64_t flags = irq_save();
+    pin_irqs[pin].fn = fn;
+    pin_irqs[pin].arg = arg;
+
+    // leave output_enable alone, so a pin can watch itself
+    gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+    cfg.input_enable = 1;
+    cfg.func_sel = GPIO_FUNC_GPIO;
+    cfg.int_mode_set = mode;
+    cfg.int_mask = 1;
+    cfg.set = 0;
+    cfg.clr = 0;
+
+    // drop whatever latched under the old mode before unmasking
+    cfg.int_clr = 1;
+    put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+    cfg.int_clr = 0;
+    cfg.int_mask = 0;
+    put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+
+    if (!irq_attached)
+        plic_enable(GPIO_IRQ, GPIO_IRQ_PRIO, gpio_irq_dispatch, 0);
+    irq_attached |= 1ULL << pin;
+    irq_restore(flags);
+}
+
+void gpio_irq_detach(unsigned pin) {
+    if (pin >= GPIO_NPINS)
+        return;
+
+    uint64_t flags = irq_save();
+    gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+    cfg.int_mask = 1;
+    cfg.set = 0;
+    cfg.clr = 0;
+    put32_type(gpio_cfg_t, GPIO_CFG0 + pin, cfg);
+
+    irq_attached &= ~(1ULL << pin);
+    pin_irqs[pin].fn = 0;
+    if (!irq_attached)
+        plic_disable(GPIO_IRQ);
+    irq_restore(flags);
+}
+
+void gpio_irq_debounce(unsigned pin, unsigned us) {
+    if (pin >= GPIO_NPINS)
+        return;
+    pin_irqs[pin].debounce = (uint64_t)us * cycle_cnt_hz() / 1000000;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "memory.h"
+#include "plic.h"
 
 typedef struct {
     uint32_t input_enable   : 1;
@@ -89,6 +90,15 @@ enum {
 
 static volatile gpio_cfg_t *const GPIO_CFG0 = (volatile gpio_cfg_t *)0x200008c4;
 
+#define GPIO_NPINS 46
+
+// bulk registers, one bit per pin, pins 0-31 in word 0 and 32-45 in
+// word 1 (gpio_cfg128-141 in the reference manual)
+static volatile uint32_t *const GPIO_IN  = (volatile uint32_t *)0x20000ac4;
+static volatile uint32_t *const GPIO_OUT = (volatile uint32_t *)0x20000ae4;
+static volatile uint32_t *const GPIO_SET = (volatile uint32_t *)0x20000aec;
+static volatile uint32_t *const GPIO_CLR = (volatile uint32_t *)0x20000af4;
+
 void gpio_set_function(unsigned pin, gpio_func_t function);
 
 void gpio_set_input(unsigned pin);
@@ -107,3 +117,74 @@ void gpio_pud_off(unsigned pin);
 
 int gpio_get_pud(unsigned pin);
 
+// write-only fast path. gpio_fast_output does the one read-modify-write
+// of the pin config (set/clr mode, output enabled); after that a level
+// change is a single store to the bulk set/clr register, no read back
+// and no put32 fences. the gpio block is strongly ordered device memory,
+// so stores still reach it in order.
+typedef struct {
+    volatile uint32_t *set;
+    volatile uint32_t *clr;
+    uint32_t mask;
+} gpio_fast_t;
+
+gpio_fast_t gpio_fast_output(unsigned pin);
+
+static inline void gpio_fast_on(gpio_fast_t p) {
+    *p.set = p.mask;
+}
+
+static inline void gpio_fast_off(gpio_fast_t p) {
+    *p.clr = p.mask;
+}
+
+static inline void gpio_fast_write(gpio_fast_t p, unsigned val) {
+    *(val ? p.set : p.clr) = p.mask;
+}
+
+// same without a handle, for pins only known at run time
+static inline void gpio_fast_set(unsigned pin) {
+    GPIO_SET[pin >> 5] = 1U << (pin & 31);
+}
+
+static inline void gpio_fast_clr(unsigned pin) {
+    GPIO_CLR[pin >> 5] = 1U << (pin & 31);
+}
+
+
+// several pins at once through the 32-bit value registers. pins set up
+// with gpio_port_output run in op_val_mode, so they ignore the set/clr
+// fast path above and follow GPIO_OUT instead. gpio_port_write reads
+// the output word back and changes all masked pins of it with one
+// store, so they switch together and the other pins keep their level;
+// pins 0-31 and 32-45 are two stores. masks are bit n = pin n.
+void gpio_port_output(uint64_t mask);
+void gpio_port_input(uint64_t mask);
+
+void gpio_port_write(uint64_t mask, uint64_t values);
+uint64_t gpio_port_read(uint64_t mask);
+
+
+// edge/level interrupts. every pin shares one PLIC source; the handler
+// collects the pending pins of everything attached and runs their
+// callbacks lowest pin first. needs trap_init and plic_init, and
+// mstatus.MIE on. mode is one of the sync_ / async_ values above; the
+// sync modes sample through the gpio clock, which already filters
+// glitches shorter than a cycle of it.
+//
+// the pin is acked before fn runs, so a level mode fires again right
+// away unless fn changes the mode or detaches.
+#ifndef GPIO_IRQ
+#define GPIO_IRQ        PLIC_IRQ(44)    // BL808 pg 45
+#endif
+#define GPIO_IRQ_PRIO   1
+
+typedef void (*gpio_irq_fn_t)(unsigned pin, void *arg);
+
+void gpio_irq_attach(unsigned pin, unsigned mode, gpio_irq_fn_t fn, void *arg);
+void gpio_irq_detach(unsigned pin);
+
+// drop edges that come less than us after the last one we passed on,
+// 0 turns it off. there is no debounce counter in the gpio block, so
+// this is done in the handler with rdcycle
+void gpio_irq_debounce(unsigned pin, unsigned us);
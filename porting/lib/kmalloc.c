@@ -0,0 +1,386 @@
+#include "kmalloc.h"
+#include "csr.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "string.h"
+
+extern char __heap_start__[], __heap_end__[];
+
+// per page descriptor: size class + 1 for slab pages, or PAGE_LARGE
+// with the run length in the upper bits for the first page of a
+// multi-page allocation. slab pages stay with their class for good.
+// a free run carries PAGE_RUN and its length on its first and last
+// page so a freed neighbour can find and merge with it; every other
+// page is PAGE_FREE.
+#define PAGE_FREE  0
+#define PAGE_RUN   0xfe
+#define PAGE_LARGE 0xff
+#define desc_slab(cls) ((cls) + 1)
+#define desc_class(d)  ((d) & 0xff)
+#define desc_npages(d) ((d) >> 8)
+
+// per-hart cache sizing: refill/drain this many objects at once
+#define CACHE_BATCH 16
+#define CACHE_MAX   (2 * CACHE_BATCH)
+
+struct free_obj {
+  struct free_obj *next;
+};
+
+// a run of free pages, stored in its own first page
+struct free_run {
+  struct free_run *next;
+  struct free_run *prev;
+  u64 npages;
+};
+
+struct hart_cache {
+  struct free_obj *head[KMALLOC_NCLASSES];
+  u32 count[KMALLOC_NCLASSES];
+
+  u64 nalloc;
+  u64 nfree;
+  u64 bytes_requested;
+  u64 bytes_allocated;
+  u64 refills;
+  u64 drains;
+  u64 bad_frees;
+} __attribute__((aligned(64)));
+
+static spinlock_t heap_lock = SPINLOCK_INIT;
+
+// all below under heap_lock
+static char *heap_base;  // first allocatable page
+static char *heap_brk;   // pages below here have been handed out once
+static char *heap_limit;
+static u32 *page_desc;
+static struct free_run *free_runs;
+static struct free_obj *class_free[KMALLOC_NCLASSES];
+static u64 pages_used;
+static u64 pages_hwm;
+static u64 class_pages[KMALLOC_NCLASSES];
+static u64 large_pages;
+
+static struct hart_cache caches[SMP_MAX_HARTS];
+
+static unsigned size_class(size_t size) {
+  if (size <= (1 << KMALLOC_MIN_SHIFT))
+    return 0;
+  // ceil(log2(size)) - min shift
+  return (64 - __builtin_clzl(size - 1)) - KMALLOC_MIN_SHIFT;
+}
+
+static size_t class_size(unsigned cls) {
+  return (size_t)1 << (cls + KMALLOC_MIN_SHIFT);
+}
+
+static u64 page_index(void *p) {
+  return ((char *)p - heap_base) / PAGE_SIZE;
+}
+
+static void *page_addr(u64 idx) {
+  return heap_base + idx * PAGE_SIZE;
+}
+
+void kmalloc_init(void) {
+  char *start = (char *)(((u64)__heap_start__ + PAGE_SIZE - 1) & ~(u64)(PAGE_SIZE - 1));
+  u64 npages = (__heap_end__ - start) / PAGE_SIZE;
+
+  // the descriptor table takes the first few pages of the heap itself
+  u64 desc_pages = (npages * sizeof(u32) + PAGE_SIZE - 1) / PAGE_SIZE;
+  page_desc = (u32 *)start;
+  heap_base = start + desc_pages * PAGE_SIZE;
+  heap_brk = heap_base;
+  heap_limit = start + npages * PAGE_SIZE;
+  memset(page_desc, 0, desc_pages * PAGE_SIZE);
+
+  free_runs = 0;
+  memset(class_free, 0, sizeof(class_free));
+  memset(class_pages, 0, sizeof(class_pages));
+  memset(caches, 0, sizeof(caches));
+  pages_used = pages_hwm = large_pages = 0;
+}
+
+// heap_lock held for the run helpers
+static void run_tag(u64 idx, u64 npages, u32 d) {
+  page_desc[idx] = d;
+  page_desc[idx + npages - 1] = d;
+}
+
+static void run_insert(u64 idx, u64 npages) {
+  struct free_run *r = page_addr(idx);
+  r->npages = npages;
+  r->prev = 0;
+  r->next = free_runs;
+  if (free_runs)
+    free_runs->prev = r;
+  free_runs = r;
+  run_tag(idx, npages, PAGE_RUN | (npages << 8));
+}
+
+static void run_remove(struct free_run *r) {
+  if (r->prev)
+    r->prev->next = r->next;
+  else
+    free_runs = r->next;
+  if (r->next)
+    r->next->prev = r->prev;
+  run_tag(page_index(r), r->npages, PAGE_FREE);
+}
+
+// first fit over the free runs, then fresh pages; heap_lock held
+static void *pages_get(unsigned npages) {
+  void *p = 0;
+
+  for (struct free_run *r = free_runs; r; r = r->next) {
+    if (r->npages < npages)
+      continue;
+    if (r->npages == npages) {
+      run_remove(r);
+      p = r;
+    } else {
+      // hand out the tail so the run header stays put
+      u64 idx = page_index(r);
+      u64 left = r->npages - npages;
+      page_desc[idx + r->npages - 1] = PAGE_FREE;
+      r->npages = left;
+      run_tag(idx, left, PAGE_RUN | (left << 8));
+      p = page_addr(idx + left);
+    }
+    break;
+  }
+
+  if (!p) {
+    if (heap_limit - heap_brk < (i64)npages * PAGE_SIZE)
+      return 0;
+    p = heap_brk;
+    heap_brk += (u64)npages * PAGE_SIZE;
+  }
+
+  pages_used += npages;
+  if (pages_used > pages_hwm)
+    pages_hwm = pages_used;
+  return p;
+}
+
+// merge with the free runs on either side; a run that ends at heap_brk
+// goes back to the untouched top of the heap. heap_lock held
+static void pages_put(void *p, unsigned npages) {
+  u64 idx = page_index(p);
+  u64 n = npages;
+
+  for (u64 i = 0; i < n; i++)
+    page_desc[idx + i] = PAGE_FREE;
+  pages_used -= npages;
+
+  if (idx > 0 && desc_class(page_desc[idx - 1]) == PAGE_RUN) {
+    u64 below = desc_npages(page_desc[idx - 1]);
+    run_remove(page_addr(idx - below));
+    idx -= below;
+    n += below;
+  }
+  if ((char *)page_addr(idx + n) < heap_brk &&
+      desc_class(page_desc[idx + n]) == PAGE_RUN)
+  {
+    struct free_run *above = page_addr(idx + n);
+    n += above->npages;
+    run_remove(above);
+  }
+
+  if ((char *)page_addr(idx + n) == heap_brk)
+    heap_brk = page_addr(idx);
+  else
+    run_insert(idx, n);
+}
+
+void *kpage_alloc(unsigned npages) {
+  if (npages == 0)
+    return 0;
+
+  u64 flags = spin_lock_irqsave(&heap_lock);
+  void *p = pages_get(npages);
+  if (p) {
+    page_desc[page_index(p)] = PAGE_LARGE | (npages << 8);
+    large_pages += npages;
+  }
+  spin_unlock_irqrestore(&heap_lock, flags);
+  return p;
+}
+
+void kpage_free(void *p, unsigned npages) {
+  u64 flags = spin_lock_irqsave(&heap_lock);
+  large_pages -= npages;
+  pages_put(p, npages);
+  spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+// move up to CACHE_BATCH objects of cls from the global list into c,
+// carving a new slab page if the global list is empty
+static void cache_refill(struct hart_cache *c, unsigned cls) {
+  u64 flags = spin_lock_irqsave(&heap_lock);
+
+  if (!class_free[cls]) {
+    char *page = pages_get(1);
+    if (page) {
+      size_t sz = class_size(cls);
+      page_desc[page_index(page)] = desc_slab(cls);
+      class_pages[cls]++;
+      for (size_t off = PAGE_SIZE; off >= sz; off -= sz) {
+        struct free_obj *o = (struct free_obj *)(page + off - sz);
+        o->next = class_free[cls];
+        class_free[cls] = o;
+      }
+    }
+  }
+
+  for (unsigned i = 0; i < CACHE_BATCH && class_free[cls]; i++) {
+    struct free_obj *o = class_free[cls];
+    class_free[cls] = o->next;
+    o->next = c->head[cls];
+    c->head[cls] = o;
+    c->count[cls]++;
+  }
+  c->refills++;
+
+  spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+// give CACHE_BATCH objects back to the global list
+static void cache_drain(struct hart_cache *c, unsigned cls) {
+  u64 flags = spin_lock_irqsave(&heap_lock);
+  for (unsigned i = 0; i < CACHE_BATCH && c->head[cls]; i++) {
+    struct free_obj *o = c->head[cls];
+    c->head[cls] = o->next;
+    c->count[cls]--;
+    o->next = class_free[cls];
+    class_free[cls] = o;
+  }
+  c->drains++;
+  spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+void *kmalloc(size_t size) {
+  if (size == 0)
+    return 0;
+
+  if (size > KMALLOC_MAX_SMALL) {
+    unsigned npages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    void *p = kpage_alloc(npages);
+    if (p) {
+      u64 flags = irq_save();
+      struct hart_cache *c = &caches[hart_id()];
+      c->nalloc++;
+      c->bytes_requested += size;
+      c->bytes_allocated += (u64)npages * PAGE_SIZE;
+      irq_restore(flags);
+    }
+    return p;
+  }
+
+  // fast path: this hart's list, no lock. interrupts are held off so
+  // a trap handler on the same hart can't interleave with us
+  unsigned cls = size_class(size);
+  u64 flags = irq_save();
+  struct hart_cache *c = &caches[hart_id()];
+  if (!c->head[cls])
+    cache_refill(c, cls);
+
+  struct free_obj *o = c->head[cls];
+  if (o) {
+    c->head[cls] = o->next;
+    c->count[cls]--;
+    c->nalloc++;
+    c->bytes_requested += size;
+    c->bytes_allocated += class_size(cls);
+  }
+  irq_restore(flags);
+  return o;
+}
+
+void *kzalloc(size_t size) {
+  void *p = kmalloc(size);
+  if (p)
+    memset(p, 0, size);
+  return p;
+}
+
+// kfree of something kmalloc never handed out: count it and leave the
+// heap alone rather than corrupt a free list
+static void bad_free(void) {
+  u64 flags = irq_save();
+  caches[hart_id()].bad_frees++;
+  irq_restore(flags);
+}
+
+void kfree(void *p) {
+  if (!p)
+    return;
+  if ((char *)p < heap_base || (char *)p >= heap_brk) {
+    bad_free();
+    return;
+  }
+
+  u64 off = ((char *)p - heap_base) % PAGE_SIZE;
+  u32 d = page_desc[page_index(p)];
+  if (desc_class(d) == PAGE_LARGE) {
+    if (off) {
+      bad_free();
+      return;
+    }
+    kpage_free(p, desc_npages(d));
+    u64 flags = irq_save();
+    caches[hart_id()].nfree++;
+    irq_restore(flags);
+    return;
+  }
+
+  // PAGE_FREE and PAGE_RUN pages hold nothing to free
+  unsigned cls = desc_class(d) - 1;
+  if (desc_class(d) == PAGE_FREE || cls >= KMALLOC_NCLASSES ||
+      off % class_size(cls))
+  {
+    bad_free();
+    return;
+  }
+
+  u64 flags = irq_save();
+  struct hart_cache *c = &caches[hart_id()];
+  struct free_obj *o = p;
+  o->next = c->head[cls];
+  c->head[cls] = o;
+  c->nfree++;
+  if (++c->count[cls] > CACHE_MAX)
+    cache_drain(c, cls);
+  irq_restore(flags);
+}
+
+void kmalloc_get_stats(struct kmalloc_stats *st) {
+  memset(st, 0, sizeof(*st));
+
+  u64 flags = spin_lock_irqsave(&heap_lock);
+  st->heap_pages = (heap_limit - heap_base) / PAGE_SIZE;
+  st->pages_used = pages_used;
+  st->pages_hwm = pages_hwm;
+  st->large_pages = large_pages;
+  for (unsigned i = 0; i < KMALLOC_NCLASSES; i++)
+    st->class_pages[i] = class_pages[i];
+  for (struct free_run *r = free_runs; r; r = r->next) {
+    st->free_runs++;
+    st->free_pages += r->npages;
+    if (r->npages > st->largest_run)
+      st->largest_run = r->npages;
+  }
+  st->fresh_pages = (heap_limit - heap_brk) / PAGE_SIZE;
+  spin_unlock_irqrestore(&heap_lock, flags);
+
+  // other harts may be mid-update; good enough for statistics
+  for (unsigned h = 0; h < SMP_MAX_HARTS; h++) {
+    st->nalloc += caches[h].nalloc;
+    st->nfree += caches[h].nfree;
+    st->bytes_requested += caches[h].bytes_requested;
+    st->bytes_allocated += caches[h].bytes_allocated;
+    st->refills += caches[h].refills;
+    st->drains += caches[h].drains;
+    st->bad_frees += caches[h].bad_frees;
+  }
+}
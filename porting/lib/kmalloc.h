@@ -0,0 +1,56 @@
+#pragma once
+
+#include "types.h"
+
+// heap allocator over the PSRAM heap (__heap_start__ .. __heap_end__).
+//
+// memory comes out of the heap in 4K pages. requests up to
+// KMALLOC_MAX_SMALL are rounded up to a power of two size class and
+// served from slab pages of that class; anything bigger gets whole
+// pages. each hart keeps a short free list per class and only takes
+// the global lock to refill or drain it in batches.
+//
+// call kmalloc_init once on hart 0 before anything allocates.
+
+#define PAGE_SIZE          4096
+#define KMALLOC_MIN_SHIFT  4  // 16 bytes
+#define KMALLOC_MAX_SHIFT  11 // 2K
+#define KMALLOC_MAX_SMALL  (1 << KMALLOC_MAX_SHIFT)
+#define KMALLOC_NCLASSES   (KMALLOC_MAX_SHIFT - KMALLOC_MIN_SHIFT + 1)
+
+struct kmalloc_stats {
+  u64 heap_pages;  // pages the heap could ever hand out
+  u64 pages_used;  // pages taken from the heap and not returned
+  u64 pages_hwm;   // high-water mark of pages_used
+  u64 class_pages[KMALLOC_NCLASSES];
+  u64 large_pages;
+
+  // external fragmentation: freed pages sit in free_runs runs below
+  // heap_brk, fresh_pages have never been handed out. largest_run
+  // well under free_pages means the free space is chopped up
+  u64 free_runs;
+  u64 free_pages;
+  u64 largest_run;
+  u64 fresh_pages;
+
+  // summed over all harts
+  u64 nalloc;
+  u64 nfree;
+  u64 bytes_requested; // what callers asked for
+  u64 bytes_allocated; // what that rounded up to
+  u64 refills;         // per-hart cache misses that took the lock
+  u64 drains;          // per-hart cache overflows that took the lock
+  u64 bad_frees;       // kfree of a pointer kmalloc never returned
+};
+
+void kmalloc_init(void);
+
+void *kmalloc(size_t size);
+void *kzalloc(size_t size);
+void kfree(void *p);
+
+// raw page interface, also used by the arena allocator
+void *kpage_alloc(unsigned npages);
+void kpage_free(void *p, unsigned npages);
+
+void kmalloc_get_stats(struct kmalloc_stats *st);
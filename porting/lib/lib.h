@@ -5,13 +5,38 @@
 #include "string.h"
 #include "types.h"
 
+#include "arena.h"
+#include "async.h"
+#include "atomic.h"
+#include "bench.h"
+#include "cache.h"
+#include "capture.h"
+#include "clint.h"
+#include "csr.h"
 #include "cycle-counter.h"
 #include "delay.h"
 #include "gpio.h"
+#include "kmalloc.h"
+#include "lz4.h"
+#include "mailbox.h"
 #include "memory.h"
+#include "perf.h"
+#include "plic.h"
+#include "prof.h"
+#include "pwm.h"
+#include "sched.h"
+#include "sections.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "sw-serial.h"
+#include "sw-uart.h"
 #include "timer.h"
+#include "trace.h"
+#include "trap.h"
+#include "uart-ring.h"
 #include "uart.h"
 #include "uartmux.h"
+#include "wave.h"
 
 #include "crc32.h"
 // #include "printk.h"
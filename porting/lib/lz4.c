@@ -0,0 +1,167 @@
+#include "lz4.h"
+
+#define MINMATCH 4
+
+enum {
+  S_TOKEN,
+  S_LIT_EXT, // more literal length bytes
+  S_LIT,
+  S_OFF_LO,
+  S_OFF_HI,
+  S_MATCH_EXT, // more match length bytes
+  S_DEAD,
+};
+
+void lz4_stream_init(struct lz4_stream *s, void *dst, u64 cap) {
+  s->start = s->out = s->polled = dst;
+  s->end = s->out + cap;
+  s->state = S_TOKEN;
+  s->len = 0;
+  s->offset = 0;
+  s->token = 0;
+  s->poll = 0;
+  s->poll_ctx = 0;
+}
+
+void lz4_stream_set_poll(struct lz4_stream *s, lz4_poll_t poll, void *ctx) {
+  s->poll = poll;
+  s->poll_ctx = ctx;
+}
+
+// copy n bytes to the output in LZ4_POLL_BYTES pieces, polling once
+// that much has gone out since the last poll. from may overlap the
+// output (a match with offset < len), hence byte by byte
+static void put(struct lz4_stream *s, const u8 *from, u64 n) {
+  while (n) {
+    u64 run = n < LZ4_POLL_BYTES ? n : LZ4_POLL_BYTES;
+    for (u64 i = 0; i < run; i++)
+      s->out[i] = from[i];
+    s->out += run;
+    from += run;
+    n -= run;
+    if (s->poll && s->out - s->polled >= LZ4_POLL_BYTES) {
+      s->polled = s->out;
+      s->poll(s->poll_ctx);
+    }
+  }
+}
+
+// the whole match is behind us already, so it goes in one go
+static bool copy_match(struct lz4_stream *s) {
+  u64 len = (u64)s->len + MINMATCH;
+
+  if (len > (u64)(s->end - s->out))
+    return false;
+  put(s, s->out - s->offset, len);
+  s->state = S_TOKEN;
+  return true;
+}
+
+bool lz4_stream_feed(struct lz4_stream *s, const void *src, u64 n) {
+  const u8 *p = src;
+  const u8 *pend = p + n;
+
+  while (p < pend) {
+    switch (s->state) {
+    case S_TOKEN:
+      s->token = *p++;
+      s->len = s->token >> 4;
+      if (s->len == 15)
+        s->state = S_LIT_EXT;
+      else
+        s->state = s->len ? S_LIT : S_OFF_LO;
+      break;
+
+    case S_LIT_EXT: {
+      u8 b = *p++;
+      s->len += b;
+      // also keeps len from wrapping on garbage
+      if (s->len > (u64)(s->end - s->out))
+        goto corrupt;
+      if (b != 255)
+        s->state = S_LIT;
+      break;
+    }
+
+    case S_LIT: {
+      u64 run = pend - p;
+      if (run > s->len)
+        run = s->len;
+      if (run > (u64)(s->end - s->out))
+        goto corrupt;
+      put(s, p, run);
+      p += run;
+      s->len -= run;
+      if (!s->len)
+        s->state = S_OFF_LO;
+      break;
+    }
+
+    case S_OFF_LO:
+      s->offset = *p++;
+      s->state = S_OFF_HI;
+      break;
+
+    case S_OFF_HI:
+      s->offset |= (u32)*p++ << 8;
+      if (s->offset == 0 || s->offset > (u64)(s->out - s->start))
+        goto corrupt;
+      s->len = s->token & 15;
+      if (s->len == 15)
+        s->state = S_MATCH_EXT;
+      else if (!copy_match(s))
+        goto corrupt;
+      break;
+
+    case S_MATCH_EXT: {
+      u8 b = *p++;
+      s->len += b;
+      if (s->len > (u64)(s->end - s->out))
+        goto corrupt;
+      if (b != 255 && !copy_match(s))
+        goto corrupt;
+      break;
+    }
+
+    default:
+      return false;
+    }
+  }
+  return true;
+
+corrupt:
+  s->state = S_DEAD;
+  return false;
+}
+
+i64 lz4_stream_finish(struct lz4_stream *s) {
+  // a block always ends on the literals of its last sequence
+  if (s->state != S_OFF_LO)
+    return -1;
+  return s->out - s->start;
+}
+
+i64 lz4_decompress_stream(lz4_read_t read, void *ctx, u64 src_len, void *dst,
+                          u64 cap) {
+  struct lz4_stream s;
+  u8 buf[256];
+
+  lz4_stream_init(&s, dst, cap);
+  while (src_len) {
+    u32 n = src_len < sizeof(buf) ? src_len : sizeof(buf);
+    read(ctx, buf, n);
+    if (!lz4_stream_feed(&s, buf, n))
+      return -1;
+    src_len -= n;
+  }
+  return lz4_stream_finish(&s);
+}
+
+i64 lz4_decompress(const void *src, u64 src_len, void *dst, u64 cap) {
+  struct lz4_stream s;
+
+  lz4_stream_init(&s, dst, cap);
+  if (!lz4_stream_feed(&s, src, src_len))
+    return -1;
+  return lz4_stream_finish(&s);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "types.h"
+
+// LZ4 block decoder. this is the raw block format; frames (.lz4 files)
+// are unpacked on the host by tools/lz4pack.py and only the blocks
+// are sent over.
+//
+// the stream interface takes the compressed bytes in whatever pieces
+// they arrive in, e.g. one bootloader frame at a time. matches are
+// copied out of the output itself, so there is no window buffer.
+//
+// decompressing in place works too: put the compressed block at the
+// very end of the output buffer and make that buffer
+// LZ4_INPLACE_MARGIN(src_len) bytes longer than the output. the writer
+// then never overtakes input it hasn't read yet.
+
+#define LZ4_INPLACE_MARGIN(src_len) (((src_len) >> 8) + 32)
+
+// a few input bytes can expand into a match as long as the block. a
+// stream with a poll hook calls it after every LZ4_POLL_BYTES or so of
+// output, so a caller that has to keep a fifo drained (boot.c) never
+// waits on more than about twice that
+#define LZ4_POLL_BYTES 1024
+typedef void (*lz4_poll_t)(void *ctx);
+
+struct lz4_stream {
+  u8 *start;
+  u8 *out; // next byte to write
+  u8 *end; // one past the last byte we may write
+  u8 *polled; // out at the last poll
+  u32 state;
+  u32 len; // literal or match length being collected/copied
+  u32 offset;
+  u8 token;
+  lz4_poll_t poll;
+  void *poll_ctx;
+};
+
+void lz4_stream_init(struct lz4_stream *s, void *dst, u64 cap);
+
+// poll(ctx) while decompressing, 0 turns it off again (the default)
+void lz4_stream_set_poll(struct lz4_stream *s, lz4_poll_t poll, void *ctx);
+
+// false on a corrupt block or one that doesn't fit; the stream is dead
+// from then on
+bool lz4_stream_feed(struct lz4_stream *s, const void *src, u64 n);
+
+// bytes written, or -1 if the input stopped in the middle of a sequence
+i64 lz4_stream_finish(struct lz4_stream *s);
+
+// pull src_len bytes through read (exactly n bytes per call), e.g.
+// uart_ring_read. on error it stops reading early.
+typedef void (*lz4_read_t)(void *ctx, void *dst, u32 n);
+i64 lz4_decompress_stream(lz4_read_t read, void *ctx, u64 src_len, void *dst,
+                          u64 cap);
+
+// memory to memory, also the in-place case
+i64 lz4_decompress(const void *src, u64 src_len, void *dst, u64 cap);
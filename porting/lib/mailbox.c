@@ -0,0 +1,138 @@
+#include "mailbox.h"
+#include "clint.h"
+#include "csr.h"
+#include "string.h"
+
+#define MBOX_MASK (MBOX_SLOTS - 1)
+
+void mbox_init(struct mbox_ring *r, unsigned consumer_hart) {
+  memset(r, 0, sizeof(*r));
+  r->consumer_hart = consumer_hart;
+  mbox_release();
+}
+
+// free slots as far as the producer knows, refreshing tail only when
+// the cached copy says we are full
+static unsigned mbox_space(struct mbox_ring *r) {
+  unsigned space = MBOX_SLOTS - (r->head - r->tail_cache);
+  if (space == 0) {
+    MBOX_CACHE_INVAL(&r->tail, sizeof(r->tail));
+    r->tail_cache = r->tail;
+    mbox_acquire();
+    space = MBOX_SLOTS - (r->head - r->tail_cache);
+  }
+  return space;
+}
+
+static void mbox_notify(struct mbox_ring *r) {
+  // order the head store before reading the consumer's flag, pairs
+  // with the fence in mbox_wait
+  asm volatile("fence rw, rw" : : : "memory");
+  MBOX_CACHE_INVAL(&r->waiting, sizeof(r->waiting));
+  if (r->waiting) {
+    r->waiting = 0;
+    r->doorbells++;
+    clint_send_ipi(r->consumer_hart);
+  }
+}
+
+unsigned mbox_send_batch(struct mbox_ring *r, const struct mbox_msg *m,
+                         unsigned n) {
+  unsigned space = mbox_space(r);
+  if (n > space)
+    n = space;
+  if (n == 0)
+    return 0;
+
+  u32 head = r->head;
+  for (unsigned i = 0; i < n; i++)
+    r->slots[(head + i) & MBOX_MASK] = m[i];
+  MBOX_CACHE_CLEAN(r->slots, sizeof(r->slots));
+
+  // slots must be visible before the new head
+  mbox_release();
+  r->head = head + n;
+  MBOX_CACHE_CLEAN(&r->head, sizeof(r->head));
+  r->sent += n;
+
+  mbox_notify(r);
+  return n;
+}
+
+bool mbox_send(struct mbox_ring *r, const struct mbox_msg *m) {
+  return mbox_send_batch(r, m, 1) == 1;
+}
+
+unsigned mbox_recv_batch(struct mbox_ring *r, struct mbox_msg *out,
+                         unsigned max) {
+  u32 tail = r->tail;
+  unsigned avail = r->head_cache - tail;
+  if (avail == 0) {
+    MBOX_CACHE_INVAL(&r->head, sizeof(r->head));
+    r->head_cache = r->head;
+    mbox_acquire();
+    avail = r->head_cache - tail;
+  }
+  if (avail > max)
+    avail = max;
+  if (avail == 0)
+    return 0;
+
+  MBOX_CACHE_INVAL(r->slots, sizeof(r->slots));
+  for (unsigned i = 0; i < avail; i++)
+    out[i] = r->slots[(tail + i) & MBOX_MASK];
+
+  // finish reading the slots before handing them back
+  mbox_release();
+  r->tail = tail + avail;
+  MBOX_CACHE_CLEAN(&r->tail, sizeof(r->tail));
+  r->received += avail;
+  r->batches++;
+  return avail;
+}
+
+bool mbox_recv(struct mbox_ring *r, struct mbox_msg *out) {
+  return mbox_recv_batch(r, out, 1) == 1;
+}
+
+void mbox_wait(struct mbox_ring *r) {
+  unsigned hart = hart_id();
+
+  // a doorbell rung just after the last wait finished may still be
+  // pending; drop it so it can't cut this sleep short
+  clint_clear_ipi(hart);
+
+  r->waiting = 1;
+  MBOX_CACHE_CLEAN(&r->waiting, sizeof(r->waiting));
+  asm volatile("fence rw, rw" : : : "memory");
+
+  // re-check after raising the flag or we can miss a send that
+  // happened just before it
+  MBOX_CACHE_INVAL(&r->head, sizeof(r->head));
+  if (r->head == r->tail) {
+    // MSIE on with mstatus.MIE off: the ipi wakes wfi without trapping.
+    // there is no IRQ_M_SOFT handler, so MSIE goes back to how we found
+    // it before MIE can come back on
+    u64 flags = irq_save();
+    u64 msie = csr_read(mie) & MIE_MSIE;
+    csr_set(mie, MIE_MSIE);
+    while (1) {
+      MBOX_CACHE_INVAL(&r->waiting, sizeof(r->waiting));
+      MBOX_CACHE_INVAL(&r->head, sizeof(r->head));
+      if (!r->waiting || r->head != r->tail)
+        break;
+      asm volatile("wfi");
+    }
+    if (!msie)
+      csr_clear(mie, MIE_MSIE);
+    irq_restore(flags);
+  }
+  r->waiting = 0;
+  MBOX_CACHE_CLEAN(&r->waiting, sizeof(r->waiting));
+  asm volatile("fence rw, rw" : : : "memory");
+
+  // the producer can see waiting before we drop it and ring after the
+  // loop above, so clear MSIP only after the final store. a doorbell
+  // later still stays pending with MSIE off and is dropped on entry
+  clint_clear_ipi(hart);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "types.h"
+
+// single-producer single-consumer message rings for talking between
+// harts through shared sram. the rings live in the .ipc section, which
+// memmap.ld pins to the start of OCRAM so both sides agree on where
+// they are.
+//
+// head is written only by the producer and tail only by the consumer,
+// and each sits on its own cache line so the two sides never bounce a
+// line they both write. the producer only rings the doorbell (an MSIP
+// ipi) when the consumer said it is going to sleep, and the consumer
+// publishes tail once per batch, so a busy ring costs no interrupts.
+//
+// the fences order the slot accesses against the index updates. the
+// C906 data cache is not coherent with the other cores, so on the real
+// board the region has to be uncached or flushed through
+// MBOX_CACHE_CLEAN/MBOX_CACHE_INVAL; they are no-ops for harts that
+// share a coherent cache (e.g. qemu).
+
+#define CACHE_LINE 64
+#define MBOX_SLOTS 64 // must be a power of two
+
+#define __ipc __attribute__((section(".ipc"), aligned(CACHE_LINE)))
+
+#ifndef MBOX_CACHE_CLEAN
+#define MBOX_CACHE_CLEAN(p, n) do { } while (0)
+#endif
+#ifndef MBOX_CACHE_INVAL
+#define MBOX_CACHE_INVAL(p, n) do { } while (0)
+#endif
+
+struct mbox_msg {
+  u32 type;
+  u32 len;
+  u64 arg;
+};
+
+struct mbox_ring {
+  // producer's cache line
+  volatile u32 head __attribute__((aligned(CACHE_LINE)));
+  u32 tail_cache; // producer's last view of tail
+  u32 consumer_hart;
+  u64 sent;
+  u64 doorbells;
+
+  // consumer's cache line
+  volatile u32 tail __attribute__((aligned(CACHE_LINE)));
+  u32 head_cache; // consumer's last view of head
+  volatile u32 waiting;
+  u64 received;
+  u64 batches;
+
+  struct mbox_msg slots[MBOX_SLOTS] __attribute__((aligned(CACHE_LINE)));
+};
+
+// acquire after reading the other side's index,
+// release before publishing ours
+#define mbox_acquire() asm volatile("fence r, rw" : : : "memory")
+#define mbox_release() asm volatile("fence rw, w" : : : "memory")
+
+void mbox_init(struct mbox_ring *r, unsigned consumer_hart);
+
+// producer side; false when the ring is full
+bool mbox_send(struct mbox_ring *r, const struct mbox_msg *m);
+// enqueue up to n messages with one head update, returns how many fit
+unsigned mbox_send_batch(struct mbox_ring *r, const struct mbox_msg *m,
+                         unsigned n);
+
+// consumer side; dequeue up to max messages with one tail update
+unsigned mbox_recv_batch(struct mbox_ring *r, struct mbox_msg *out,
+                         unsigned max);
+bool mbox_recv(struct mbox_ring *r, struct mbox_msg *out);
+
+// consumer side; sleep in wfi until the producer rings the doorbell
+void mbox_wait(struct mbox_ring *r);
@@ -0,0 +1,214 @@
+#include "perf.h"
+#include "csr.h"
+#include "string.h"
+
+// t-head csrs the assembler doesn't know by name:
+//   0x320 mcountinhibit, 0x7ca mcounterinten, 0x7cb mcounterof
+// bit n of each of them is mhpmcounter n
+
+#define SLOT_BIT(slot) (1UL << (3 + (slot)))
+
+_Static_assert(sizeof(struct perf_counts) == PERF_NFIELDS * sizeof(u64),
+               "perf_counts is walked as an array");
+
+static enum perf_event selected[PERF_NSLOTS];
+static struct perf_region *regions;
+
+static u64 sample_period[PERF_NSLOTS];
+static perf_sample_fn_t sample_fn[PERF_NSLOTS];
+
+static const char *const event_names[] = {
+  [PERF_NONE] = "none",
+  [PERF_L1I_ACCESS] = "l1i-access",
+  [PERF_L1I_MISS] = "l1i-miss",
+  [PERF_IUTLB_MISS] = "iutlb-miss",
+  [PERF_DUTLB_MISS] = "dutlb-miss",
+  [PERF_JTLB_MISS] = "jtlb-miss",
+  [PERF_BR_MISPREDICT] = "br-mispredict",
+  [PERF_BR] = "br",
+  [PERF_IND_BR_MISPREDICT] = "ind-br-mispredict",
+  [PERF_IND_BR] = "ind-br",
+  [PERF_LSU_SPEC_FAIL] = "lsu-spec-fail",
+  [PERF_STORE] = "store",
+  [PERF_L1D_READ] = "l1d-read",
+  [PERF_L1D_READ_MISS] = "l1d-read-miss",
+  [PERF_L1D_WRITE] = "l1d-write",
+  [PERF_L1D_WRITE_MISS] = "l1d-write-miss",
+};
+
+// csr numbers are immediates, hence the switches
+u64 perf_read(unsigned slot) {
+  switch (slot) {
+  case 0: return csr_read(mhpmcounter3);
+  case 1: return csr_read(mhpmcounter4);
+  case 2: return csr_read(mhpmcounter5);
+  case 3: return csr_read(mhpmcounter6);
+  }
+  return 0;
+}
+
+static void counter_write(unsigned slot, u64 val) {
+  switch (slot) {
+  case 0: csr_write(mhpmcounter3, val); break;
+  case 1: csr_write(mhpmcounter4, val); break;
+  case 2: csr_write(mhpmcounter5, val); break;
+  case 3: csr_write(mhpmcounter6, val); break;
+  }
+}
+
+static void event_write(unsigned slot, u64 ev) {
+  switch (slot) {
+  case 0: csr_write(mhpmevent3, ev); break;
+  case 1: csr_write(mhpmevent4, ev); break;
+  case 2: csr_write(mhpmevent5, ev); break;
+  case 3: csr_write(mhpmevent6, ev); break;
+  }
+}
+
+void perf_init(void) {
+  // nothing inhibited, no overflow interrupts, nothing pending
+  csr_write(0x320, 0);
+  csr_write(0x7ca, 0);
+  csr_write(0x7cb, 0);
+  for (unsigned i = 0; i < PERF_NSLOTS; i++)
+    perf_select(i, PERF_NONE);
+}
+
+void perf_select(unsigned slot, enum perf_event ev) {
+  if (slot >= PERF_NSLOTS)
+    return;
+  selected[slot] = ev;
+  event_write(slot, ev);
+  counter_write(slot, 0);
+}
+
+enum perf_event perf_selected(unsigned slot) {
+  return slot < PERF_NSLOTS ? selected[slot] : PERF_NONE;
+}
+
+const char *perf_event_name(enum perf_event ev) {
+  if ((unsigned)ev < sizeof(event_names) / sizeof(event_names[0]))
+    return event_names[ev];
+  return "?";
+}
+
+void perf_snapshot(struct perf_counts *c) {
+  c->cycles = csr_read(mcycle);
+  c->instret = csr_read(minstret);
+  for (unsigned i = 0; i < PERF_NSLOTS; i++)
+    c->slot[i] = perf_read(i);
+}
+
+void perf_start(struct perf_region *r) {
+  if (!r->listed) {
+    r->listed = true;
+    r->next = regions;
+    regions = r;
+  }
+  perf_snapshot(&r->start);
+}
+
+void perf_stop(struct perf_region *r) {
+  struct perf_counts now;
+  perf_snapshot(&now);
+
+  const u64 *a = (const u64 *)&r->start;
+  const u64 *b = (const u64 *)&now;
+  for (unsigned f = 0; f < PERF_NFIELDS; f++) {
+    u64 d = b[f] - a[f];
+    if (r->n == 0 || d < r->min[f])
+      r->min[f] = d;
+    if (d > r->max[f])
+      r->max[f] = d;
+    r->sum[f] += d;
+  }
+  r->n++;
+}
+
+struct perf_region *perf_scope_begin(struct perf_region *r) {
+  perf_start(r);
+  return r;
+}
+
+void perf_scope_end(struct perf_region **r) {
+  perf_stop(*r);
+}
+
+static void put_field(volatile struct uart *uart, const char *name,
+                      const struct perf_region *r, unsigned f) {
+  uart_puts(uart, "  ");
+  uart_puts(uart, name);
+  uart_puts(uart, ": ");
+  uart_putdec(uart, r->min[f]);
+  uart_putc(uart, '/');
+  uart_putdec(uart, r->sum[f] / r->n);
+  uart_putc(uart, '/');
+  uart_putdec(uart, r->max[f]);
+  uart_puts(uart, "\r\n");
+}
+
+void perf_dump(volatile struct uart *uart) {
+  uart_puts(uart, "perf: min/avg/max per region\r\n");
+  for (struct perf_region *r = regions; r; r = r->next) {
+    if (!r->n)
+      continue;
+    uart_puts(uart, r->name);
+    uart_puts(uart, " (n=");
+    uart_putdec(uart, r->n);
+    uart_puts(uart, ")\r\n");
+    put_field(uart, "cycles", r, 0);
+    put_field(uart, "instret", r, 1);
+    for (unsigned i = 0; i < PERF_NSLOTS; i++) {
+      if (selected[i] != PERF_NONE)
+        put_field(uart, perf_event_name(selected[i]), r, 2 + i);
+    }
+  }
+}
+
+void perf_reset(void) {
+  for (struct perf_region *r = regions; r; r = r->next) {
+    r->n = 0;
+    memset(r->min, 0, sizeof(r->min));
+    memset(r->max, 0, sizeof(r->max));
+    memset(r->sum, 0, sizeof(r->sum));
+  }
+}
+
+// counters count up and flag overflow when they wrap, so start them
+// `period` below zero
+static struct trapframe *perf_overflow(struct trapframe *tf) {
+  u64 of = csr_read(0x7cb);
+
+  for (unsigned i = 0; i < PERF_NSLOTS; i++) {
+    if (!(of & SLOT_BIT(i)))
+      continue;
+    counter_write(i, -sample_period[i]);
+    csr_clear(0x7cb, SLOT_BIT(i));
+    if (sample_fn[i])
+      sample_fn[i](i, tf);
+  }
+  return tf;
+}
+
+void perf_sample_start(unsigned slot, u64 period, perf_sample_fn_t fn) {
+  if (slot >= PERF_NSLOTS || period == 0)
+    return;
+
+  sample_period[slot] = period;
+  sample_fn[slot] = fn;
+  counter_write(slot, -period);
+  trap_register_irq(IRQ_M_PERF, perf_overflow);
+  csr_set(0x7ca, SLOT_BIT(slot));
+  csr_set(mie, MIE_MOIE);
+}
+
+void perf_sample_stop(unsigned slot) {
+  if (slot >= PERF_NSLOTS)
+    return;
+
+  csr_clear(0x7ca, SLOT_BIT(slot));
+  csr_clear(0x7cb, SLOT_BIT(slot));
+  sample_fn[slot] = 0;
+  if (!(csr_read(0x7ca) & 0xfffffff8))
+    csr_clear(mie, MIE_MOIE);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "trap.h"
+#include "types.h"
+#include "uart.h"
+
+// C906 hardware event counters, c906 pg 650-660. slot i is
+// mhpmcounter(3 + i), counting whatever event sits in mhpmevent(3 + i).
+// cycles and instret are always sampled on top of the slots.
+//
+// perf_init once, then perf_select the events you want. everything
+// here is per hart and none of it is locked; measure on one hart.
+
+#define PERF_NSLOTS 4
+
+// counter overflow interrupt, c906 specific (mip bit 17)
+#define IRQ_M_PERF  17
+#define MIE_MOIE    (1UL << IRQ_M_PERF)
+
+enum perf_event {
+  PERF_NONE = 0,
+  PERF_L1I_ACCESS = 0x1,
+  PERF_L1I_MISS = 0x2,
+  PERF_IUTLB_MISS = 0x3,
+  PERF_DUTLB_MISS = 0x4,
+  PERF_JTLB_MISS = 0x5,
+  PERF_BR_MISPREDICT = 0x6, // conditional branches
+  PERF_BR = 0x7,
+  PERF_IND_BR_MISPREDICT = 0x8,
+  PERF_IND_BR = 0x9,
+  PERF_LSU_SPEC_FAIL = 0xa,
+  PERF_STORE = 0xb,
+  PERF_L1D_READ = 0xc,
+  PERF_L1D_READ_MISS = 0xd,
+  PERF_L1D_WRITE = 0xe,
+  PERF_L1D_WRITE_MISS = 0xf,
+};
+
+struct perf_counts {
+  u64 cycles;
+  u64 instret;
+  u64 slot[PERF_NSLOTS];
+};
+
+#define PERF_NFIELDS (2 + PERF_NSLOTS)
+
+void perf_init(void);
+void perf_select(unsigned slot, enum perf_event ev);
+enum perf_event perf_selected(unsigned slot);
+const char *perf_event_name(enum perf_event ev);
+
+u64 perf_read(unsigned slot);
+void perf_snapshot(struct perf_counts *c);
+
+// a named region, aggregated over every start/stop pair. a region must
+// not be re-entered before it is stopped (no recursion)
+struct perf_region {
+  const char *name;
+  struct perf_region *next; // all regions seen so far, for perf_dump
+  bool listed;
+  u64 n;
+  struct perf_counts start;
+  u64 min[PERF_NFIELDS];
+  u64 max[PERF_NFIELDS];
+  u64 sum[PERF_NFIELDS];
+};
+
+#define PERF_REGION_INIT(str) { .name = (str) }
+
+void perf_start(struct perf_region *r);
+void perf_stop(struct perf_region *r);
+
+// measure from here to the end of the enclosing block:
+//   { PERF_SCOPE("uart_puts"); uart_puts(UART0, s); }
+#define PERF_CAT_(a, b) a##b
+#define PERF_CAT(a, b)  PERF_CAT_(a, b)
+#define PERF_SCOPE(str)                                                    \
+  static struct perf_region PERF_CAT(__perf_region_, __LINE__) =           \
+      PERF_REGION_INIT(str);                                               \
+  struct perf_region *PERF_CAT(__perf_scope_, __LINE__)                    \
+      __attribute__((cleanup(perf_scope_end))) =                           \
+          perf_scope_begin(&PERF_CAT(__perf_region_, __LINE__))
+
+struct perf_region *perf_scope_begin(struct perf_region *r);
+void perf_scope_end(struct perf_region **r);
+
+// min/avg/max of every field for every region that ran
+void perf_dump(volatile struct uart *uart);
+void perf_reset(void);
+
+// overflow sampling: every `period` events on slot, fn gets the
+// interrupted frame. the handler reloads the counter; call trap_init
+// before this
+typedef void (*perf_sample_fn_t)(unsigned slot, struct trapframe *tf);
+void perf_sample_start(unsigned slot, u64 period, perf_sample_fn_t fn);
+void perf_sample_stop(unsigned slot);
@@ -0,0 +1,75 @@
+#include "plic.h"
+#include "csr.h"
+#include "memory.h"
+#include "sections.h"
+#include "trap.h"
+
+#define PLIC_PRIO     ((volatile u32 *)(PLIC_BASE + 0x0000000))
+#define PLIC_IP       ((volatile u32 *)(PLIC_BASE + 0x0001000))
+#define PLIC_H0_MIE   ((volatile u32 *)(PLIC_BASE + 0x0002000))
+#define PLIC_H0_MTH   ((volatile u32 *)(PLIC_BASE + 0x0200000))
+#define PLIC_H0_MCLAIM ((volatile u32 *)(PLIC_BASE + 0x0200004))
+
+#define NWORDS (PLIC_NSOURCES / 32)
+
+struct source {
+  plic_handler_t fn;
+  void *arg;
+};
+
+static struct source sources[PLIC_NSOURCES] __fast_bss;
+
+// claim, run, complete until nothing is left. a level source that is
+// still asserted just comes straight back on the next claim
+__hot_text static struct trapframe *plic_dispatch(struct trapframe *tf) {
+  u32 irq;
+  while ((irq = *PLIC_H0_MCLAIM) != 0) {
+    if (irq < PLIC_NSOURCES && sources[irq].fn)
+      sources[irq].fn(irq, sources[irq].arg);
+    *PLIC_H0_MCLAIM = irq;
+  }
+  return tf;
+}
+
+void plic_init(void) {
+  for (unsigned w = 0; w < NWORDS; w++)
+    put32(&PLIC_H0_MIE[w], 0);
+  put32(PLIC_H0_MTH, 0);
+
+  // anything claimed before we got here has to be completed or the
+  // gateway keeps that source blocked
+  u32 irq;
+  while ((irq = get32(PLIC_H0_MCLAIM)) != 0)
+    put32(PLIC_H0_MCLAIM, irq);
+
+  trap_register_irq(IRQ_M_EXT, plic_dispatch);
+  csr_set(mie, MIE_MEIE);
+}
+
+void plic_enable(unsigned irq, unsigned prio, plic_handler_t fn, void *arg) {
+  if (irq >= PLIC_NSOURCES || prio == 0 || prio > PLIC_PRIO_MAX)
+    return;
+
+  u64 flags = irq_save();
+  sources[irq].fn = fn;
+  sources[irq].arg = arg;
+  put32(&PLIC_PRIO[irq], prio);
+  put32(&PLIC_H0_MIE[irq / 32], get32(&PLIC_H0_MIE[irq / 32]) | 1U << (irq % 32));
+  irq_restore(flags);
+}
+
+void plic_disable(unsigned irq) {
+  if (irq >= PLIC_NSOURCES)
+    return;
+
+  u64 flags = irq_save();
+  put32(&PLIC_H0_MIE[irq / 32], get32(&PLIC_H0_MIE[irq / 32]) & ~(1U << (irq % 32)));
+  sources[irq].fn = 0;
+  irq_restore(flags);
+}
+
+bool plic_pending(unsigned irq) {
+  if (irq >= PLIC_NSOURCES)
+    return false;
+  return (get32(&PLIC_IP[irq / 32]) >> (irq % 32)) & 1;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "types.h"
+
+// the c906 PLIC, at mapbaddr (0xe0000000), c906 pg 89-95. source ids
+// are the BL808 interrupt numbers plus PLIC_IRQ_BASE (the first 16 are
+// the core's own, BL808 pg 45). only hart 0's M-mode context is used.
+#define PLIC_BASE       0xe0000000UL
+#define PLIC_IRQ_BASE   16
+#define PLIC_IRQ(n)     (PLIC_IRQ_BASE + (n))
+
+// enable words past the third one fault, so that is all we can route
+#define PLIC_NSOURCES   96
+
+// priority 0 never fires, the threshold is left at 0
+#define PLIC_PRIO_MAX   31
+
+typedef void (*plic_handler_t)(unsigned irq, void *arg);
+
+// masks every source, drains stale claims and takes over the machine
+// external interrupt. call trap_init first; mstatus.MIE stays yours
+void plic_init(void);
+
+// route irq to fn at prio (1..PLIC_PRIO_MAX), one handler per source
+void plic_enable(unsigned irq, unsigned prio, plic_handler_t fn, void *arg);
+void plic_disable(unsigned irq);
+
+bool plic_pending(unsigned irq);
@@ -0,0 +1,102 @@
+#include "prof.h"
+#include "clint.h"
+#include "crc32.h"
+#include "csr.h"
+#include "sections.h"
+#include "trap.h"
+
+static struct prof_sample *samples __fast_bss;
+static u32 capacity __fast_bss;
+static u32 count __fast_bss;
+static u32 dropped __fast_bss;
+static bool with_ra __fast_bss;
+
+static unsigned rate __fast_bss;
+static u64 period __fast_bss;
+static u64 next_deadline __fast_bss;
+
+__hot_text static struct trapframe *prof_tick(struct trapframe *tf) {
+  // stay on the absolute grid so the rate doesn't drift with our own
+  // overhead, unless we fell a whole period behind
+  u64 now = clint_mtime();
+  next_deadline += period;
+  if ((i64)(next_deadline - now) <= 0)
+    next_deadline = now + period;
+  clint_set_timecmp(hart_id(), next_deadline);
+
+  if (count < capacity) {
+    samples[count].pc = tf->mepc;
+    samples[count].ra = with_ra ? tf->x[1] : 0;
+    count++;
+  } else {
+    dropped++;
+  }
+  return tf;
+}
+
+void prof_init(struct prof_sample *buf, u32 nsamples, unsigned rate_hz,
+               bool ra) {
+  samples = buf;
+  capacity = nsamples;
+  with_ra = ra;
+  rate = rate_hz;
+  period = CLINT_TIMER_HZ / rate_hz;
+  if (period == 0)
+    period = 1;
+  prof_reset();
+
+  trap_init();
+  clint_init();
+  trap_register_irq(IRQ_M_TIMER, prof_tick);
+}
+
+void prof_start(void) {
+  next_deadline = clint_timer_arm(period);
+  csr_set(mie, MIE_MTIE);
+  irq_enable();
+}
+
+void prof_stop(void) {
+  csr_clear(mie, MIE_MTIE);
+  clint_timer_disarm();
+}
+
+void prof_reset(void) {
+  count = 0;
+  dropped = 0;
+}
+
+u32 prof_count(void) {
+  return count;
+}
+
+u32 prof_dropped(void) {
+  return dropped;
+}
+
+static void put_u32(volatile struct uart *uart, u32 v) {
+  for (unsigned i = 0; i < 4; i++)
+    uart_putc(uart, v >> (8 * i));
+}
+
+void prof_dump(volatile struct uart *uart) {
+  u32 n = count;
+  u32 crc = 0;
+
+  put_u32(uart, PROF_MAGIC);
+  put_u32(uart, PROF_VERSION);
+  put_u32(uart, rate);
+  put_u32(uart, with_ra ? PROF_FLAG_RA : 0);
+  put_u32(uart, n);
+  put_u32(uart, dropped);
+
+  for (u32 i = 0; i < n; i++) {
+    put_u32(uart, samples[i].pc);
+    crc = crc32_inc(&samples[i].pc, 4, crc);
+    if (with_ra) {
+      put_u32(uart, samples[i].ra);
+      crc = crc32_inc(&samples[i].ra, 4, crc);
+    }
+  }
+  put_u32(uart, crc);
+}
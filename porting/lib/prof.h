@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types.h"
+#include "uart.h"
+
+// statistical profiler. a CLINT timer interrupt every 1/rate_hz s
+// records the interrupted pc, and optionally ra, into a caller supplied
+// buffer. once the buffer is full further samples are only counted.
+// prof_dump streams everything out in the binary format below, which
+// tools/prof.py turns into folded stacks for flamegraph.pl.
+//
+// the profiler owns the machine timer interrupt while it runs, so it
+// can't be used together with sched or async_run.
+//
+// dump format, all little endian u32:
+//   magic, version, rate_hz, flags, nsamples, dropped,
+//   nsamples x (pc [, ra if PROF_FLAG_RA]),
+//   crc32 of the sample words
+
+#define PROF_MAGIC   0x464f5250 // "PROF"
+#define PROF_VERSION 1
+#define PROF_FLAG_RA 1
+
+// addresses all fit in 32 bits on this part
+struct prof_sample {
+  u32 pc;
+  u32 ra;
+};
+
+void prof_init(struct prof_sample *buf, u32 nsamples, unsigned rate_hz,
+               bool with_ra);
+void prof_start(void);
+void prof_stop(void);
+void prof_reset(void);
+
+u32 prof_count(void);
+u32 prof_dropped(void);
+
+void prof_dump(volatile struct uart *uart);
@@ -0,0 +1,94 @@
+#include "pwm.h"
+#include "gpio.h"
+#include "memory.h"
+
+#define PWM_BASE 0x2000a400UL
+
+// per group registers, group g at 0x40 + 0x40 * g
+#define MC_CONFIG0(g)  ((volatile u32 *)(PWM_BASE + 0x40 + 0x40 * (g)))
+#define MC_CONFIG1(g)  ((volatile u32 *)(PWM_BASE + 0x44 + 0x40 * (g)))
+#define MC_PERIOD(g)   ((volatile u32 *)(PWM_BASE + 0x48 + 0x40 * (g)))
+#define MC_THRE(g, ch) ((volatile u32 *)(PWM_BASE + 0x50 + 0x40 * (g) + 4 * (ch)))
+
+// config0
+#define CLK_DIV_MASK   0xffff
+#define STOP_EN        (1U << 27)
+#define STS_STOP       (1U << 29)
+#define CLK_SEL_MASK   (3U << 30) // 0 = xclk
+
+// config1, per channel: positive enable/idle, negative enable/idle
+#define CH_PEN(ch)     (1U << (4 * (ch)))
+#define CH_NEN(ch)     (1U << (4 * (ch) + 2))
+
+// output enables as last written, so gating doesn't read the bus
+static u32 config1[PWM_NGROUPS];
+static u16 period[PWM_NGROUPS];
+
+static unsigned pin_channel(unsigned pin) {
+  return pin % 4;
+}
+
+static u32 pin_enable(unsigned pin) {
+  unsigned ch = pin_channel(pin);
+  return (pin % 8) < 4 ? CH_PEN(ch) : CH_NEN(ch);
+}
+
+unsigned pwm_init(unsigned group, unsigned hz) {
+  if (group >= PWM_NGROUPS || hz == 0)
+    return 0;
+
+  // smallest divider that gets the period into 16 bits
+  u32 div = 1;
+  while (PWM_CLOCK_HZ / div / hz > 0xffff)
+    div++;
+  u32 counts = PWM_CLOCK_HZ / div / hz;
+  if (counts < 2 || div > 0xffff)
+    return 0;
+
+  pwm_halt(group);
+
+  // idle levels all 0, polarities positive, outputs off
+  config1[group] = 0;
+  put32(MC_CONFIG1(group), 0);
+  put32(MC_PERIOD(group), counts);
+  period[group] = counts;
+
+  u32 c0 = get32(MC_CONFIG0(group));
+  c0 &= ~(CLK_DIV_MASK | CLK_SEL_MASK);
+  c0 |= div;
+  c0 &= ~STOP_EN;
+  put32(MC_CONFIG0(group), c0);
+  while (get32(MC_CONFIG0(group)) & STS_STOP)
+    ;
+
+  return PWM_CLOCK_HZ / div / counts;
+}
+
+void pwm_halt(unsigned group) {
+  if (group >= PWM_NGROUPS)
+    return;
+  put32(MC_CONFIG0(group), get32(MC_CONFIG0(group)) | STOP_EN);
+  while (!(get32(MC_CONFIG0(group)) & STS_STOP))
+    ;
+}
+
+void pwm_attach(unsigned group, unsigned pin, unsigned duty_pct) {
+  if (group >= PWM_NGROUPS || duty_pct > 100)
+    return;
+
+  // the output is high while threl <= counter < threh
+  u32 high = (u32)period[group] * duty_pct / 100;
+  put32(MC_THRE(group, pin_channel(pin)), high << 16);
+
+  config1[group] &= ~pin_enable(pin);
+  put32(MC_CONFIG1(group), config1[group]);
+  gpio_set_function(pin, group ? GPIO_FUNC_PWM1 : GPIO_FUNC_PWM0);
+}
+
+pwm_gate_t pwm_gate(unsigned group, unsigned pin) {
+  return (pwm_gate_t){
+      .reg = MC_CONFIG1(group),
+      .shadow = &config1[group],
+      .mask = pin_enable(pin),
+  };
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "types.h"
+
+// the BL808 PWM block (pwm_v2 in the bouffalo sdk) at 0x2000a400. two
+// groups, each with one 16 bit counter and four channels with a
+// positive and a negative output. a pin's function picks the group
+// (GPIO_FUNC_PWM0/PWM1), its number the output: pin % 8 is ch0..3
+// positive for 0-3 and ch0..3 negative for 4-7.
+//
+// the counter runs off the 40 MHz xclk, so one group does anything
+// from about 610 Hz to 20 MHz. an output that is gated off sits at
+// its idle level, low.
+
+#define PWM_NGROUPS   2
+#define PWM_CLOCK_HZ  40000000
+
+// period and clock for the whole group, counter running, every output
+// gated off. returns the frequency actually set, 0 if out of range
+unsigned pwm_init(unsigned group, unsigned hz);
+void pwm_halt(unsigned group);
+
+// route pin to its channel in group with duty in percent, gated off
+void pwm_attach(unsigned group, unsigned pin, unsigned duty_pct);
+
+// switching the output on and off is a single store to the group's
+// output enable register, with the other channels' bits kept in RAM
+typedef struct {
+  volatile u32 *reg;
+  u32 *shadow;
+  u32 mask;
+} pwm_gate_t;
+
+pwm_gate_t pwm_gate(unsigned group, unsigned pin);
+
+static inline void pwm_gate_on(pwm_gate_t g) {
+  *g.shadow |= g.mask;
+  *g.reg = *g.shadow;
+}
+
+static inline void pwm_gate_off(pwm_gate_t g) {
+  *g.shadow &= ~g.mask;
+  *g.reg = *g.shadow;
+}
+
+static inline void pwm_gate_write(pwm_gate_t g, unsigned on) {
+  if (on)
+    pwm_gate_on(g);
+  else
+    pwm_gate_off(g);
+}
@@ -0,0 +1,218 @@
+#include "sched.h"
+#include "clint.h"
+#include "csr.h"
+#include "cycle-counter.h"
+#include "sections.h"
+#include "string.h"
+
+struct runq {
+  struct thread *head;
+  struct thread *tail;
+};
+
+// everything the tick touches sits in WRAM
+static struct thread threads[SCHED_MAX_THREADS] __fast_bss;
+static struct thread *current __fast_bss;
+
+// bit p is set iff runq[p] is non-empty
+static u32 ready_mask __fast_bss;
+static struct runq runq[SCHED_NPRIO] __fast_bss;
+
+static u64 quantum_ticks __fast_bss;
+static u64 next_deadline __fast_bss;
+static struct sched_stats stats __fast_bss;
+
+__hot_text static void runq_push(struct thread *t) {
+  struct runq *q = &runq[t->prio];
+
+  t->next = 0;
+  t->state = THREAD_READY;
+  t->ready_at = cycle_cnt_read();
+  if (q->tail)
+    q->tail->next = t;
+  else
+    q->head = t;
+  q->tail = t;
+  ready_mask |= 1U << t->prio;
+}
+
+// caller guarantees ready_mask != 0; main is always runnable
+__hot_text static struct thread *runq_pop(void) {
+  // lowest set bit is the highest priority with work
+  unsigned prio = __builtin_ctz(ready_mask);
+  struct runq *q = &runq[prio];
+  struct thread *t = q->head;
+
+  q->head = t->next;
+  if (!q->head) {
+    q->tail = 0;
+    ready_mask &= ~(1U << prio);
+  }
+  return t;
+}
+
+// close the running slice of the current thread
+__hot_text static void account(struct trapframe *tf) {
+  u64 now = cycle_cnt_read();
+  current->cpu_cycles += now - current->dispatched_at;
+  current->dispatched_at = now;
+  current->tf = tf;
+}
+
+__hot_text static struct trapframe *switch_to(struct thread *next) {
+  u64 now = cycle_cnt_read();
+  u64 waited = now - next->ready_at;
+
+  next->wait_total += waited;
+  if (waited > next->wait_max)
+    next->wait_max = waited;
+  next->ndispatch++;
+  next->dispatched_at = now;
+  next->state = THREAD_RUNNING;
+
+  if (next != current)
+    stats.switches++;
+  current = next;
+  return next->tf;
+}
+
+__hot_text static struct trapframe *sched_tick(struct trapframe *tf) {
+  u64 now = clint_mtime();
+  u64 late = now - next_deadline;
+
+  stats.ticks++;
+  stats.tick_latency_total += late;
+  if (late > stats.tick_latency_max)
+    stats.tick_latency_max = late;
+
+  // keep the deadlines on an absolute grid unless we fell a whole
+  // quantum behind, then restart the grid from now
+  next_deadline += quantum_ticks;
+  if ((i64)(next_deadline - now) <= 0)
+    next_deadline = now + quantum_ticks;
+  clint_set_timecmp(hart_id(), next_deadline);
+
+  account(tf);
+
+  // anyone at our priority or better? (prio 31 wraps to all ones)
+  if (ready_mask & ((2U << current->prio) - 1)) {
+    runq_push(current);
+    return switch_to(runq_pop());
+  }
+  return tf;
+}
+
+__hot_text static struct trapframe *sched_ecall(struct trapframe *tf) {
+  // resume after the ecall
+  tf->mepc += 4;
+  account(tf);
+
+  switch (tf->x[17]) {
+  case SCHED_ECALL_YIELD:
+    runq_push(current);
+    break;
+  case SCHED_ECALL_EXIT:
+    current->state = THREAD_DONE;
+    break;
+  }
+  return switch_to(runq_pop());
+}
+
+void sched_set_quantum(unsigned quantum_us) {
+  quantum_ticks = (u64)quantum_us * CLINT_TIMER_HZ / 1000000;
+  if (quantum_ticks == 0)
+    quantum_ticks = 1;
+}
+
+void sched_init(unsigned quantum_us) {
+  memset(threads, 0, sizeof(threads));
+  memset(runq, 0, sizeof(runq));
+  memset(&stats, 0, sizeof(stats));
+  ready_mask = 0;
+
+  current = &threads[0];
+  current->name = "main";
+  current->prio = SCHED_PRIO_IDLE;
+  current->state = THREAD_RUNNING;
+
+  sched_set_quantum(quantum_us);
+
+  trap_init();
+  clint_init();
+  trap_register_irq(IRQ_M_TIMER, sched_tick);
+  trap_register_exc(EXC_ECALL_M, sched_ecall);
+}
+
+struct thread *sched_spawn(const char *name, thread_fn_t fn, void *arg,
+                           unsigned prio, void *stack, size_t stack_size) {
+  if (prio >= SCHED_NPRIO || stack_size < 2 * TF_SIZE)
+    return 0;
+
+  u64 flags = irq_save();
+  struct thread *t = 0;
+  for (unsigned i = 1; i < SCHED_MAX_THREADS; i++) {
+    if (threads[i].state == THREAD_FREE || threads[i].state == THREAD_DONE) {
+      t = &threads[i];
+      break;
+    }
+  }
+  if (!t) {
+    irq_restore(flags);
+    return 0;
+  }
+  memset(t, 0, sizeof(*t));
+  t->name = name;
+  t->prio = prio;
+
+  // build the frame trap.S would have pushed, at the top of the stack;
+  // returning from fn lands in sched_exit
+  u64 top = ((u64)stack + stack_size) & ~15UL;
+  struct trapframe *tf = (struct trapframe *)(top - TF_SIZE);
+  memset(tf, 0, sizeof(*tf));
+  u64 gp;
+  asm volatile("mv %0, gp" : "=r"(gp));
+  tf->x[1] = (u64)sched_exit;
+  tf->x[3] = gp;
+  tf->x[10] = (u64)arg;
+  tf->mepc = (u64)fn;
+  tf->mstatus = (csr_read(mstatus) & ~MSTATUS_MIE) | MSTATUS_MPP | MSTATUS_MPIE;
+  t->tf = tf;
+
+  runq_push(t);
+  irq_restore(flags);
+  return t;
+}
+
+void sched_start(void) {
+  current->dispatched_at = cycle_cnt_read();
+  next_deadline = clint_timer_arm(quantum_ticks);
+  csr_set(mie, MIE_MTIE);
+  irq_enable();
+
+  // main sits at idle priority, so this runs everybody else first
+  sched_yield();
+}
+
+void sched_yield(void) {
+  register u64 a7 asm("a7") = SCHED_ECALL_YIELD;
+  asm volatile("ecall" : : "r"(a7) : "memory");
+}
+
+void sched_exit(void) {
+  register u64 a7 asm("a7") = SCHED_ECALL_EXIT;
+  asm volatile("ecall" : : "r"(a7) : "memory");
+  while (1)
+    ;
+}
+
+struct thread *sched_current(void) {
+  return current;
+}
+
+struct thread *sched_thread(unsigned i) {
+  return i < SCHED_MAX_THREADS ? &threads[i] : 0;
+}
+
+const struct sched_stats *sched_get_stats(void) {
+  return &stats;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "trap.h"
+#include "types.h"
+
+// preemptive round-robin scheduler driven by the CLINT timer.
+// priority 0 is the highest; threads at the same priority share the
+// cpu in quantum-sized slices. one hart only for now.
+#define SCHED_NPRIO       32
+#define SCHED_PRIO_IDLE   (SCHED_NPRIO - 1)
+#define SCHED_MAX_THREADS 16
+
+// a7 values for the ecall based yield/exit
+#define SCHED_ECALL_YIELD 1
+#define SCHED_ECALL_EXIT  2
+
+enum thread_state {
+  THREAD_FREE = 0,
+  THREAD_READY,
+  THREAD_RUNNING,
+  THREAD_DONE,
+};
+
+struct thread {
+  struct trapframe *tf; // saved context while not running
+  struct thread *next;  // run queue link
+  const char *name;
+  unsigned prio;
+  enum thread_state state;
+
+  // accounting, all in rdcycle units
+  u64 cpu_cycles;    // time spent running
+  u64 dispatched_at; // start of the current slice
+  u64 ready_at;      // when it last went on a run queue
+  u64 wait_total;    // time spent runnable but not running
+  u64 wait_max;
+  u64 ndispatch;
+};
+
+struct sched_stats {
+  u64 ticks;
+  u64 switches;
+  // how late the timer interrupt was taken, in mtime ticks
+  u64 tick_latency_total;
+  u64 tick_latency_max;
+};
+
+typedef void (*thread_fn_t)(void *arg);
+
+// the boot context becomes the "main" thread at idle priority
+void sched_init(unsigned quantum_us);
+void sched_set_quantum(unsigned quantum_us);
+
+// stack is caller owned and must outlive the thread
+struct thread *sched_spawn(const char *name, thread_fn_t fn, void *arg,
+                           unsigned prio, void *stack, size_t stack_size);
+
+// arm the timer and hand the cpu to the highest priority thread,
+// returns (as the main thread) once nothing better is runnable
+void sched_start(void);
+
+void sched_yield(void);
+void sched_exit(void) __attribute__((noreturn));
+
+struct thread *sched_current(void);
+struct thread *sched_thread(unsigned i);
+const struct sched_stats *sched_get_stats(void);
@@ -0,0 +1,8 @@
+#pragma once
+
+// placement in on-chip WRAM instead of PSRAM, see memmap.ld.
+// use for code and data on latency-critical paths (trap entry,
+// scheduler, uart fifo access). WRAM is only 160K, so be picky.
+#define __hot_text  __attribute__((section(".hot_text")))
+#define __fast_data __attribute__((section(".fast_data")))
+#define __fast_bss  __attribute__((section(".fast_bss")))
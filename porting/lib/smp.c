@@ -0,0 +1,114 @@
+#include "smp.h"
+#include "atomic.h"
+#include "clint.h"
+#include "csr.h"
+#include "spinlock.h"
+#include "trap.h"
+
+// one request slot per hart, each on its own cache line
+struct smp_slot {
+  spinlock_t lock; // serializes callers posting to this hart
+  smp_fn_t volatile fn;
+  void *volatile arg;
+  volatile u32 online;
+} __attribute__((aligned(64)));
+
+static struct smp_slot slots[SMP_MAX_HARTS];
+
+static void smp_ping(void *arg) {
+}
+
+void smp_secondary_main(unsigned hart) {
+  struct smp_slot *s = &slots[hart];
+
+  trap_init();
+  s->online = 1;
+  smp_mb();
+
+  while (1) {
+    clint_clear_ipi(hart);
+    smp_mb();
+
+    smp_fn_t fn = s->fn;
+    if (fn) {
+      smp_rmb();
+      fn(s->arg);
+      // done: the slot is free for the next request
+      smp_mb();
+      s->fn = 0;
+      continue;
+    }
+
+    // MSIE is still the only thing enabled in mie, see start.S
+    while (!(csr_read(mip) & MIE_MSIE) && !s->fn)
+      asm volatile("wfi");
+  }
+}
+
+static void smp_post(unsigned hart, smp_fn_t fn, void *arg) {
+  struct smp_slot *s = &slots[hart];
+
+  spin_lock(&s->lock);
+  while (s->fn)
+    cpu_relax();
+  s->arg = arg;
+  smp_wmb();
+  s->fn = fn;
+  smp_mb();
+  spin_unlock(&s->lock);
+
+  clint_send_ipi(hart);
+}
+
+unsigned smp_init(unsigned timeout_us) {
+  unsigned self = hart_id();
+  unsigned n = 1;
+
+  slots[self].online = 1;
+  for (unsigned h = 0; h < SMP_MAX_HARTS; h++) {
+    if (h == self)
+      continue;
+
+    struct smp_slot *s = &slots[h];
+    smp_post(h, smp_ping, 0);
+    u64 deadline = clint_mtime() + (u64)timeout_us * CLINT_TIMER_HZ / 1000000;
+    while (!s->online && (i64)(deadline - clint_mtime()) > 0)
+      cpu_relax();
+
+    // take back the ping of a hart that never showed up, or the next
+    // smp_init or post to it would wait on the slot forever. if it
+    // comes up after all it just finds an empty slot
+    spin_lock(&s->lock);
+    if (!s->online)
+      s->fn = 0;
+    spin_unlock(&s->lock);
+
+    if (s->online)
+      n++;
+  }
+  return n;
+}
+
+bool smp_hart_online(unsigned hart) {
+  return hart < SMP_MAX_HARTS && slots[hart].online;
+}
+
+bool smp_call_on(unsigned hart, smp_fn_t fn, void *arg) {
+  if (hart == hart_id()) {
+    fn(arg);
+    return true;
+  }
+  if (!smp_hart_online(hart))
+    return false;
+
+  smp_post(hart, fn, arg);
+  return true;
+}
+
+void smp_wait(unsigned hart) {
+  if (!smp_hart_online(hart))
+    return;
+  while (slots[hart].fn)
+    cpu_relax();
+  smp_mb();
+}
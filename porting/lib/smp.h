@@ -0,0 +1,28 @@
+#pragma once
+
+// harts we carve stacks for. start.S hands this to the linker scripts
+// as __max_harts, so this is the only place it is set.
+// the BL808 D0 has one C906 hart, the rest is for qemu -smp.
+#define SMP_MAX_HARTS 4
+
+#ifndef __ASSEMBLER__
+#include "types.h"
+
+typedef void (*smp_fn_t)(void *arg);
+
+// wake every secondary once and see who answers within timeout_us,
+// returns the number of harts online including this one
+unsigned smp_init(unsigned timeout_us);
+bool smp_hart_online(unsigned hart);
+
+// run fn(arg) on the given hart; returns as soon as the request is
+// posted. false if the hart is not online. calling it for our own
+// hart just runs fn here.
+bool smp_call_on(unsigned hart, smp_fn_t fn, void *arg);
+
+// block until the hart has finished its last smp_call_on request
+void smp_wait(unsigned hart);
+
+// start.S jumps here once hart 0 sends the first ipi
+void smp_secondary_main(unsigned hart) __attribute__((noreturn));
+#endif
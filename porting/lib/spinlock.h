@@ -0,0 +1,157 @@
+#pragma once
+
+#include "atomic.h"
+#include "csr.h"
+#include "types.h"
+
+// spinlocks for code shared between harts. the plain versions do not
+// touch interrupts; if the same lock is also taken from a trap handler
+// use the _irqsave versions, which clear mstatus.MIE exactly like
+// disable_interrupts/irq_disable and put back whatever was there
+// before, so they nest inside code that already runs with it off.
+
+// test-and-test-and-set: spin on a plain load so waiters share the
+// line until the holder writes it
+typedef struct {
+  volatile u32 locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+static inline bool spin_trylock(spinlock_t *l) {
+  u32 old;
+  asm volatile("amoswap.w.aq %0, %2, %1"
+               : "=r"(old), "+A"(l->locked)
+               : "r"(1)
+               : "memory");
+  return old == 0;
+}
+
+static inline void spin_lock(spinlock_t *l) {
+  while (!spin_trylock(l)) {
+    while (l->locked)
+      cpu_relax();
+  }
+}
+
+static inline void spin_unlock(spinlock_t *l) {
+  asm volatile("amoswap.w.rl zero, zero, %0" : "+A"(l->locked) : : "memory");
+}
+
+// ticket lock: fifo handoff so no hart starves under contention.
+// next lives in the upper half of the word so taking a ticket is one
+// amoadd; only the holder ever writes owner.
+typedef union {
+  volatile u32 word;
+  struct {
+    volatile u16 owner;
+    volatile u16 next;
+  };
+} ticketlock_t;
+
+#define TICKETLOCK_INIT { 0 }
+
+static inline void ticket_lock(ticketlock_t *l) {
+  u32 old;
+  asm volatile("amoadd.w.aq %0, %2, %1"
+               : "=r"(old), "+A"(l->word)
+               : "r"(1U << 16)
+               : "memory");
+  u16 ticket = old >> 16;
+  while (l->owner != ticket)
+    cpu_relax();
+  smp_mb();
+}
+
+static inline void ticket_unlock(ticketlock_t *l) {
+  asm volatile("fence rw, w" : : : "memory");
+  l->owner = l->owner + 1;
+}
+
+// reader-writer lock: count > 0 is that many readers, -1 is a writer.
+// readers can starve a writer; keep read sections short.
+typedef struct {
+  volatile i32 count;
+} rwlock_t;
+
+#define RWLOCK_INIT { 0 }
+
+static inline void read_lock(rwlock_t *l) {
+  i32 tmp;
+  asm volatile("1: lr.w.aq %0, %1\n"
+               "   bltz %0, 1b\n"
+               "   addi %0, %0, 1\n"
+               "   sc.w %0, %0, %1\n"
+               "   bnez %0, 1b"
+               : "=&r"(tmp), "+A"(l->count)
+               :
+               : "memory");
+}
+
+static inline void read_unlock(rwlock_t *l) {
+  asm volatile("amoadd.w.rl zero, %1, %0"
+               : "+A"(l->count)
+               : "r"(-1)
+               : "memory");
+}
+
+static inline void write_lock(rwlock_t *l) {
+  i32 tmp;
+  asm volatile("1: lr.w.aq %0, %1\n"
+               "   bnez %0, 1b\n"
+               "   li %0, -1\n"
+               "   sc.w %0, %0, %1\n"
+               "   bnez %0, 1b"
+               : "=&r"(tmp), "+A"(l->count)
+               :
+               : "memory");
+}
+
+static inline void write_unlock(rwlock_t *l) {
+  asm volatile("amoswap.w.rl zero, zero, %0" : "+A"(l->count) : : "memory");
+}
+
+// interrupt-safe variants, return the saved MIE bit
+static inline u64 spin_lock_irqsave(spinlock_t *l) {
+  u64 flags = irq_save();
+  spin_lock(l);
+  return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *l, u64 flags) {
+  spin_unlock(l);
+  irq_restore(flags);
+}
+
+static inline u64 ticket_lock_irqsave(ticketlock_t *l) {
+  u64 flags = irq_save();
+  ticket_lock(l);
+  return flags;
+}
+
+static inline void ticket_unlock_irqrestore(ticketlock_t *l, u64 flags) {
+  ticket_unlock(l);
+  irq_restore(flags);
+}
+
+static inline u64 read_lock_irqsave(rwlock_t *l) {
+  u64 flags = irq_save();
+  read_lock(l);
+  return flags;
+}
+
+static inline void read_unlock_irqrestore(rwlock_t *l, u64 flags) {
+  read_unlock(l);
+  irq_restore(flags);
+}
+
+static inline u64 write_lock_irqsave(rwlock_t *l) {
+  u64 flags = irq_save();
+  write_lock(l);
+  return flags;
+}
+
+static inline void write_unlock_irqrestore(rwlock_t *l, u64 flags) {
+  write_unlock(l);
+  irq_restore(flags);
+}
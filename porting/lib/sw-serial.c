@@ -0,0 +1,228 @@
+#include "sw-serial.h"
+#include "atomic.h"
+#include "clint.h"
+#include "csr.h"
+#include "cycle-counter.h"
+#include "gpio.h"
+#include "sections.h"
+#include "trap.h"
+
+#define MASK (SW_SERIAL_BUF - 1)
+
+// 8N1
+#define FRAME_BITS 10
+
+struct chan {
+  u64 tx_bit; // port mask of the pin, 0 for none
+  u64 rx_bit;
+
+  u8 tx_buf[SW_SERIAL_BUF];
+  volatile u32 tx_head; // main loop
+  volatile u32 tx_tail; // handler
+  u32 tx_shift;
+  unsigned tx_nbits; // left in tx_shift
+  unsigned tx_phase; // ticks until the next bit
+
+  u8 rx_buf[SW_SERIAL_BUF];
+  volatile u32 rx_head; // handler
+  volatile u32 rx_tail; // main loop
+  u32 rx_shift;
+  unsigned rx_bit_no; // 0 start, 1-8 data, 9 stop; rx_wait 0 = idle
+  unsigned rx_wait;   // ticks until the next sample
+};
+
+static struct chan chans[SW_SERIAL_MAX_CHANNELS] __fast_bss;
+static unsigned nchans __fast_bss;
+static unsigned os __fast_bss;
+static u64 tx_pins __fast_bss;
+static u64 rx_pins __fast_bss;
+static u64 out __fast_bss; // tx levels for the next tick
+
+// tick deadlines in mtime ticks, 16 fractional bits
+static u64 period_q16 __fast_bss;
+static u64 next_q16 __fast_bss;
+
+static struct sw_serial_stats stats __fast_bss;
+
+__hot_text static void tx_step(struct chan *c) {
+  if (--c->tx_phase)
+    return;
+  c->tx_phase = os;
+
+  if (!c->tx_nbits && c->tx_tail != c->tx_head) {
+    // start bit low, data lsb first, stop bit high
+    c->tx_shift = (u32)c->tx_buf[c->tx_tail & MASK] << 1 | 1 << 9;
+    c->tx_nbits = FRAME_BITS;
+    c->tx_tail++;
+  }
+
+  unsigned level = 1; // idle
+  if (c->tx_nbits) {
+    level = c->tx_shift & 1;
+    c->tx_shift >>= 1;
+    c->tx_nbits--;
+  }
+  out = level ? out | c->tx_bit : out & ~c->tx_bit;
+}
+
+__hot_text static void rx_step(struct chan *c, u64 in) {
+  unsigned level = (in & c->rx_bit) != 0;
+
+  if (!c->rx_wait) {
+    if (level)
+      return;
+    // falling edge somewhere in the last tick, aim for the middle of
+    // the start bit
+    c->rx_wait = os / 2;
+    c->rx_bit_no = 0;
+    c->rx_shift = 0;
+    return;
+  }
+
+  if (--c->rx_wait)
+    return;
+
+  if (c->rx_bit_no == 0) {
+    if (level) // glitch, not a start bit
+      return;
+  } else if (c->rx_bit_no <= 8) {
+    c->rx_shift |= level << (c->rx_bit_no - 1);
+  } else {
+    if (!level)
+      stats.rx_framing++;
+    else if (c->rx_head - c->rx_tail > MASK)
+      stats.rx_overruns++;
+    else
+      c->rx_buf[c->rx_head++ & MASK] = c->rx_shift;
+    return; // rx_wait is 0, idle again
+  }
+  c->rx_bit_no++;
+  c->rx_wait = os;
+}
+
+__hot_text static struct trapframe *tick(struct trapframe *tf) {
+  u64 start = cycle_cnt_read();
+
+  // every channel sees the same instant: write what was decided last
+  // tick, then sample
+  gpio_port_write(tx_pins, out);
+  u64 in = gpio_port_read(rx_pins);
+
+  next_q16 += period_q16;
+  u64 now = clint_mtime();
+  if ((i64)((next_q16 >> 16) - now) <= 0)
+    next_q16 = (now + 1) << 16;
+  clint_set_timecmp(hart_id(), next_q16 >> 16);
+
+  for (unsigned i = 0; i < nchans; i++) {
+    struct chan *c = &chans[i];
+    if (c->tx_bit)
+      tx_step(c);
+    if (c->rx_bit)
+      rx_step(c, in);
+  }
+
+  u64 cycles = cycle_cnt_read() - start;
+  stats.ticks++;
+  stats.busy_cycles += cycles;
+  if (cycles > stats.max_cycles)
+    stats.max_cycles = cycles;
+  return tf;
+}
+
+void sw_serial_init(unsigned baud, unsigned oversample) {
+  os = oversample < 3 ? 3 : oversample > 4 ? 4 : oversample;
+  period_q16 = ((u64)CLINT_TIMER_HZ << 16) / ((u64)baud * os);
+  nchans = 0;
+  tx_pins = rx_pins = 0;
+  out = 0;
+  sw_serial_reset_stats();
+}
+
+int sw_serial_add(unsigned tx_pin, unsigned rx_pin) {
+  if (nchans == SW_SERIAL_MAX_CHANNELS)
+    return -1;
+
+  struct chan *c = &chans[nchans];
+  c->tx_bit = tx_pin < GPIO_NPINS ? 1ULL << tx_pin : 0;
+  c->rx_bit = rx_pin < GPIO_NPINS ? 1ULL << rx_pin : 0;
+  c->tx_head = c->tx_tail = 0;
+  c->tx_nbits = 0;
+  c->tx_phase = 1;
+  c->rx_head = c->rx_tail = 0;
+  c->rx_wait = 0;
+
+  if (c->tx_bit) {
+    out |= c->tx_bit;
+    tx_pins |= c->tx_bit;
+    gpio_port_write(c->tx_bit, c->tx_bit);
+    gpio_port_output(c->tx_bit);
+  }
+  if (c->rx_bit) {
+    rx_pins |= c->rx_bit;
+    gpio_port_input(c->rx_bit);
+    gpio_set_pullup(rx_pin);
+  }
+  return nchans++;
+}
+
+void sw_serial_start(void) {
+  clint_init();
+  trap_register_irq(IRQ_M_TIMER, tick);
+  next_q16 = (clint_mtime() + 1) << 16;
+  clint_set_timecmp(hart_id(), next_q16 >> 16);
+  csr_set(mie, MIE_MTIE);
+}
+
+void sw_serial_stop(void) {
+  csr_clear(mie, MIE_MTIE);
+  clint_timer_disarm();
+}
+
+u32 sw_serial_write(unsigned ch, const void *buf, u32 n) {
+  struct chan *c = &chans[ch];
+  const u8 *p = buf;
+  u32 i = 0;
+  while (i < n && c->tx_head - c->tx_tail < SW_SERIAL_BUF) {
+    c->tx_buf[c->tx_head & MASK] = p[i++];
+    // the byte has to be there before the handler can see it
+    smp_wmb();
+    c->tx_head++;
+  }
+  return i;
+}
+
+u32 sw_serial_tx_free(unsigned ch) {
+  return SW_SERIAL_BUF - (chans[ch].tx_head - chans[ch].tx_tail);
+}
+
+bool sw_serial_tx_idle(unsigned ch) {
+  return chans[ch].tx_head == chans[ch].tx_tail && !chans[ch].tx_nbits;
+}
+
+int sw_serial_getc(unsigned ch) {
+  struct chan *c = &chans[ch];
+  if (c->rx_head == c->rx_tail)
+    return -1;
+  u8 b = c->rx_buf[c->rx_tail & MASK];
+  // read the slot before handing it back to the handler
+  smp_mb();
+  c->rx_tail++;
+  return b;
+}
+
+u32 sw_serial_rx_count(unsigned ch) {
+  return chans[ch].rx_head - chans[ch].rx_tail;
+}
+
+void sw_serial_stats(struct sw_serial_stats *st) {
+  u64 flags = irq_save();
+  *st = stats;
+  irq_restore(flags);
+}
+
+void sw_serial_reset_stats(void) {
+  u64 flags = irq_save();
+  stats = (struct sw_serial_stats){0};
+  irq_restore(flags);
+}
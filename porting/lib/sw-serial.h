@@ -0,0 +1,56 @@
+#pragma once
+
+#include "types.h"
+
+// many software uarts off one timer interrupt. every tick (oversample
+// ticks per bit, 3 or 4) the handler writes all tx pins with one
+// gpio_port_write, reads all rx pins with one gpio_port_read, and
+// steps every channel's bit state machines. the line state is only
+// ever touched through those two calls, so the cost per tick is the
+// two bus accesses plus a few dozen cycles per channel.
+//
+// all channels share the baud rate. rx sees the start bit up to a tick
+// after its edge and samples each bit oversample / 2 (rounded down)
+// ticks after that. with oversample 3 the sample point is off the
+// middle by at most half a tick, 1/6 of a bit; with 4 it is always
+// late, by up to a whole tick, 1/4 of a bit, so 3 leaves more margin.
+// on top of that comes the timer jitter: mtime counts microseconds, so
+// at 57600 baud the tick edges land within 1us (6% of a bit) of where
+// they belong, on an absolute schedule that doesn't drift.
+//
+// like prof and wave_send this owns the machine timer interrupt while
+// it runs. needs trap_init and interrupts on.
+
+#define SW_SERIAL_MAX_CHANNELS 8
+#define SW_SERIAL_BUF          64 // per direction, power of two
+#define SW_SERIAL_NOPIN        (~0u)
+
+struct sw_serial_stats {
+  u64 ticks;
+  u64 busy_cycles; // inside the tick handler, not counting trap entry
+  u64 max_cycles;  // longest tick
+  u32 rx_overruns;
+  u32 rx_framing;
+};
+
+// oversample is clamped to 3..4
+void sw_serial_init(unsigned baud, unsigned oversample);
+
+// a channel with either pin SW_SERIAL_NOPIN is tx or rx only. returns
+// the channel number, -1 when they are all taken. add before start
+int sw_serial_add(unsigned tx_pin, unsigned rx_pin);
+
+void sw_serial_start(void);
+void sw_serial_stop(void);
+
+// queue what fits, returns how much that was
+u32 sw_serial_write(unsigned ch, const void *buf, u32 n);
+u32 sw_serial_tx_free(unsigned ch);
+bool sw_serial_tx_idle(unsigned ch);
+
+// -1 if nothing is there
+int sw_serial_getc(unsigned ch);
+u32 sw_serial_rx_count(unsigned ch);
+
+void sw_serial_stats(struct sw_serial_stats *st);
+void sw_serial_reset_stats(void);
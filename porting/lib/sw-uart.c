@@ -0,0 +1,145 @@
+#include "sw-uart.h"
+#include "csr.h"
+#include "cycle-counter.h"
+#include "sections.h"
+
+// 8N1
+#define FRAME_BITS 10
+
+// time from the start stamp to the first edge of a write
+#define LEAD_CYCLES 64
+
+static void rx_push(struct sw_uart *s, u8 c) {
+  u32 h = s->rx_head;
+  if (h - s->rx_tail > s->rx_mask) {
+    s->rx_overruns++;
+    return;
+  }
+  s->rx_buf[h & s->rx_mask] = c;
+  s->rx_head = h + 1;
+}
+
+// sample every bit cell whose middle is before `now` at the current
+// line level, and finish the frame once the stop bit is sampled
+__hot_text static void rx_sample_until(struct sw_uart *s, u64 now) {
+  while (s->in_frame) {
+    u64 mid = s->frame_start +
+              ((2 * s->nsampled + 1) * s->hz) / (2 * (u64)s->baud);
+    if ((i64)(now - mid) <= 0)
+      return;
+
+    if (s->nsampled >= 1 && s->nsampled <= 8)
+      s->shift |= s->level << (s->nsampled - 1);
+    s->nsampled++;
+
+    if (s->nsampled == FRAME_BITS) {
+      s->in_frame = false;
+      if (s->level)
+        rx_push(s, s->shift);
+      else
+        s->rx_framing++;
+    }
+  }
+}
+
+__hot_text static void rx_edge(unsigned pin, void *arg) {
+  struct sw_uart *s = arg;
+  u64 now = cycle_cnt_read();
+  unsigned level = (GPIO_IN[pin >> 5] >> (pin & 31)) & 1;
+
+  // the level held until this edge, for every cell that ended before it
+  rx_sample_until(s, now);
+
+  if (!s->in_frame && level == 0 && s->level == 1) {
+    s->in_frame = true;
+    s->frame_start = now;
+    s->nsampled = 0;
+    s->shift = 0;
+  }
+  s->level = level;
+}
+
+void sw_uart_init(struct sw_uart *s, unsigned tx_pin, unsigned rx_pin,
+                  unsigned baud, u8 *rx_buf, u32 rx_size) {
+  s->baud = baud;
+  s->hz = cycle_cnt_hz();
+  s->bit_cycles = s->hz / baud;
+
+  s->rx_pin = rx_pin;
+  s->rx_buf = rx_buf;
+  s->rx_mask = rx_size - 1;
+  s->rx_head = s->rx_tail = 0;
+  s->rx_overruns = s->rx_framing = 0;
+  s->in_frame = false;
+
+  // idle is high
+  s->tx = gpio_fast_output(tx_pin);
+  gpio_fast_on(s->tx);
+
+  gpio_set_input(rx_pin);
+  gpio_set_pullup(rx_pin);
+  s->level = gpio_read(rx_pin);
+  gpio_irq_attach(rx_pin, sync_both_edge, rx_edge, s);
+}
+
+static inline void wait_until(u64 deadline) {
+  while ((i64)(cycle_cnt_read() - deadline) < 0)
+    ;
+}
+
+__hot_text void sw_uart_write(struct sw_uart *s, const void *buf, u32 n) {
+  const u8 *p = buf;
+  u64 t0 = cycle_cnt_read() + LEAD_CYCLES;
+  u64 bit = 0;
+
+  for (u32 i = 0; i < n; i++) {
+    // start bit low, data lsb first, stop bit high
+    u32 frame = (u32)p[i] << 1 | 1 << 9;
+    for (unsigned k = 0; k < FRAME_BITS; k++, bit++) {
+      wait_until(t0 + bit * s->hz / s->baud);
+      gpio_fast_write(s->tx, (frame >> k) & 1);
+    }
+  }
+  // let the last stop bit run out
+  wait_until(t0 + bit * s->hz / s->baud);
+}
+
+void sw_uart_putc(struct sw_uart *s, u8 c) {
+  sw_uart_write(s, &c, 1);
+}
+
+void sw_uart_puts(struct sw_uart *s, const char *str) {
+  u32 n = 0;
+  while (str[n])
+    n++;
+  sw_uart_write(s, str, n);
+}
+
+u32 sw_uart_available(struct sw_uart *s) {
+  // a byte whose stop bit is over but had no edge after it
+  u64 flags = irq_save();
+  rx_sample_until(s, cycle_cnt_read());
+  irq_restore(flags);
+  return s->rx_head - s->rx_tail;
+}
+
+int sw_uart_try_getc(struct sw_uart *s) {
+  if (!sw_uart_available(s))
+    return -1;
+  u8 c = s->rx_buf[s->rx_tail & s->rx_mask];
+  s->rx_tail++;
+  return c;
+}
+
+u8 sw_uart_getc(struct sw_uart *s) {
+  int c;
+  while ((c = sw_uart_try_getc(s)) < 0)
+    ;
+  return c;
+}
+
+void sw_uart_read(struct sw_uart *s, void *buf, u32 n) {
+  u8 *p = buf;
+  for (u32 i = 0; i < n; i++)
+    p[i] = sw_uart_getc(s);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "gpio.h"
+#include "types.h"
+
+// full duplex 8N1 uart on any two gpios.
+//
+// tx is bit-banged against absolute rdcycle deadlines: bit k of a
+// write is due at start + k * hz / baud, so nothing accumulates over a
+// long write. interrupts stay on while it sends (rx needs them), and a
+// handler that runs across a deadline only delays that one edge.
+//
+// rx never busy-waits. the rx pin interrupts on both edges and the
+// handler only notes the time and level; the bits are recovered by
+// sampling that edge history in the middle of each bit cell, counted
+// from the falling edge of the start bit. the last bits of a byte
+// often end without an edge, so a byte is finished by the next start
+// bit or by the reader once its stop bit is over.
+//
+// timing comes from cycle_cnt_hz(), so calibrate first. needs
+// trap_init, plic_init and interrupts on.
+
+struct sw_uart {
+  gpio_fast_t tx;
+  unsigned rx_pin;
+  unsigned baud;
+  u64 hz;
+  u32 bit_cycles;
+
+  // rx ring, filled from the edge handler
+  u8 *rx_buf;
+  u32 rx_mask;
+  volatile u32 rx_head;
+  volatile u32 rx_tail;
+  u32 rx_overruns;
+  u32 rx_framing; // stop bit was low, byte dropped
+
+  // frame being received
+  bool in_frame;
+  unsigned level;   // line level since the last edge
+  u64 frame_start;  // falling edge of the start bit
+  unsigned nsampled; // bit cells 0 (start) .. 9 (stop) done
+  u32 shift;
+};
+
+// rx_buf size must be a power of two
+void sw_uart_init(struct sw_uart *s, unsigned tx_pin, unsigned rx_pin,
+                  unsigned baud, u8 *rx_buf, u32 rx_size);
+
+void sw_uart_write(struct sw_uart *s, const void *buf, u32 n);
+void sw_uart_putc(struct sw_uart *s, u8 c);
+void sw_uart_puts(struct sw_uart *s, const char *str);
+
+u32 sw_uart_available(struct sw_uart *s);
+// -1 if nothing is there
+int sw_uart_try_getc(struct sw_uart *s);
+u8 sw_uart_getc(struct sw_uart *s);
+void sw_uart_read(struct sw_uart *s, void *buf, u32 n);
@@ -1,5 +1,6 @@
 #include "timer.h"
 #include "memory.h"
+#include "sections.h"
 
 static const unsigned cpu_freq = 480 * 1000 * 1000;
 
@@ -19,7 +20,7 @@ void timer_init(unsigned frequency) {
   rmw(mm_misc_cpu_d0, 1 << 31, 1 << 31); // enable timer
 }
 
-u64 timer_read(void) {
+__hot_text u64 timer_read(void) {
   u64 time;
   asm volatile("csrr %0, time":"=r"(time));
   return time;
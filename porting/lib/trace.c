@@ -0,0 +1,89 @@
+#include "trace.h"
+#include "atomic.h"
+#include "crc32.h"
+#include "csr.h"
+#include "cycle-counter.h"
+#include "sections.h"
+#include "smp.h"
+
+// one writer per ring, but an interrupt can log in the middle of a
+// log on the same hart, so slots are claimed with an amoadd
+struct trace_ring {
+  atomic_t head; // free running
+  struct trace_entry e[TRACE_ENTRIES];
+} __attribute__((aligned(64)));
+
+// without make TRACE=1 nothing calls in, so don't spend WRAM on it
+#ifdef TRACE
+#define NRINGS SMP_MAX_HARTS
+#else
+#define NRINGS 0
+#endif
+
+static struct trace_ring rings[NRINGS] __fast_bss;
+static volatile bool enabled __fast_data = NRINGS != 0;
+
+__hot_text void trace_log(void *fn, bool exit, u64 cycles) {
+  if (!enabled)
+    return;
+
+  struct trace_ring *r = &rings[hart_id()];
+  u32 i = atomic_fetch_add(&r->head, 1);
+  struct trace_entry *e = &r->e[i & (TRACE_ENTRIES - 1)];
+  e->cycles = cycles;
+  e->fn = (u64)fn | (exit ? TRACE_EXIT_BIT : 0);
+}
+
+// lib is built without -finstrument-functions, the attribute only
+// matters if someone turns it on for everything
+__hot_text __attribute__((no_instrument_function)) void
+__cyg_profile_func_enter(void *fn, void *call_site) {
+  trace_log(fn, false, cycle_cnt_read());
+}
+
+__hot_text __attribute__((no_instrument_function)) void
+__cyg_profile_func_exit(void *fn, void *call_site) {
+  trace_log(fn, true, cycle_cnt_read());
+}
+
+void trace_enable(bool on) {
+  enabled = on && NRINGS != 0;
+}
+
+static void put_bytes(volatile struct uart *uart, const void *p, unsigned n) {
+  const u8 *b = p;
+  for (unsigned i = 0; i < n; i++)
+    uart_putc(uart, b[i]);
+}
+
+static void put_u32(volatile struct uart *uart, u32 v) {
+  put_bytes(uart, &v, 4);
+}
+
+void trace_dump(volatile struct uart *uart) {
+  u32 crc = 0;
+
+  enabled = false;
+  smp_mb();
+
+  put_u32(uart, TRACE_MAGIC);
+  put_u32(uart, TRACE_VERSION);
+  put_u32(uart, NRINGS);
+  put_u32(uart, cycle_cnt_hz());
+
+  for (unsigned h = 0; h < NRINGS; h++) {
+    struct trace_ring *r = &rings[h];
+    u32 head = atomic_read(&r->head);
+    u32 n = head < TRACE_ENTRIES ? head : TRACE_ENTRIES;
+
+    put_u32(uart, h);
+    put_u32(uart, n);
+    // oldest first
+    for (u32 i = head - n; i != head; i++) {
+      struct trace_entry *e = &r->e[i & (TRACE_ENTRIES - 1)];
+      put_bytes(uart, e, sizeof(*e));
+      crc = crc32_inc(e, sizeof(*e), crc);
+    }
+  }
+  put_u32(uart, crc);
+}
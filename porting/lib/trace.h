@@ -0,0 +1,46 @@
+#pragma once
+
+#include "types.h"
+#include "uart.h"
+
+// function entry/exit tracing, built with make TRACE=1. payloads are
+// compiled with -finstrument-functions and every entry/exit lands here
+// as (rdcycle, function address) in a per-hart ring in WRAM. lib itself
+// is not instrumented; boot (_cstart) and trap dispatch log themselves
+// through TRACE_ENTER/TRACE_EXIT. the ring keeps the newest
+// TRACE_ENTRIES events, nothing is formatted until trace_dump.
+// without TRACE=1 the rings take no space and trace_dump sends an
+// empty dump.
+//
+// call trace_dump(UART0) where the timeline should end, and
+// tools/trace.py turns the dump into chrome://tracing / perfetto json.
+//
+// dump format, little endian:
+//   u32 magic, u32 version, u32 nharts, u32 cycles_per_second,
+//   per hart: u32 hart, u32 n, n x (u64 cycles, u64 fn | TRACE_EXIT_BIT)
+//   u32 crc32 of all the entries
+
+#define TRACE_ENTRIES  512 // per hart, power of two
+#define TRACE_MAGIC    0x45435254 // "TRCE"
+#define TRACE_VERSION  1
+#define TRACE_EXIT_BIT 1UL // functions are 4 byte aligned
+
+struct trace_entry {
+  u64 cycles;
+  u64 fn;
+};
+
+void trace_log(void *fn, bool exit, u64 cycles);
+void trace_enable(bool on);
+
+// stops tracing, then streams every hart's ring out
+void trace_dump(volatile struct uart *uart);
+
+#ifdef TRACE
+#include "cycle-counter.h"
+#define TRACE_ENTER(fn) trace_log((void *)(fn), false, cycle_cnt_read())
+#define TRACE_EXIT(fn)  trace_log((void *)(fn), true, cycle_cnt_read())
+#else
+#define TRACE_ENTER(fn) do { } while (0)
+#define TRACE_EXIT(fn)  do { } while (0)
+#endif
@@ -0,0 +1,55 @@
+#include "trap.h"
+#include "csr.h"
+#include "sections.h"
+#include "trace.h"
+#include "uart.h"
+
+_Static_assert(sizeof(struct trapframe) == TF_SIZE, "trap.S frame layout");
+
+#define NCAUSES 32
+
+static trap_handler_t irq_handlers[NCAUSES] __fast_bss;
+static trap_handler_t exc_handlers[NCAUSES] __fast_bss;
+
+void trap_init(void) {
+  csr_write(mtvec, (u64)trap_entry);
+}
+
+void trap_register_irq(unsigned irq, trap_handler_t fn) {
+  if (irq < NCAUSES)
+    irq_handlers[irq] = fn;
+}
+
+void trap_register_exc(unsigned exc, trap_handler_t fn) {
+  if (exc < NCAUSES)
+    exc_handlers[exc] = fn;
+}
+
+static void trap_panic(struct trapframe *tf, u64 mcause) {
+  uart_puts(UART0, "unhandled trap\nmcause: ");
+  uart_puthex64(mcause);
+  uart_puts(UART0, "\nmepc:   ");
+  uart_puthex64(tf->mepc);
+  uart_puts(UART0, "\nmtval:  ");
+  uart_puthex64(csr_read(mtval));
+  uart_putc(UART0, '\n');
+  while (1)
+    asm volatile("wfi");
+}
+
+__hot_text struct trapframe *trap_dispatch(struct trapframe *tf) {
+  u64 mcause = csr_read(mcause);
+  unsigned code = mcause & 0xff;
+  trap_handler_t fn = 0;
+
+  if (code < NCAUSES)
+    fn = (mcause >> 63) ? irq_handlers[code] : exc_handlers[code];
+
+  if (!fn)
+    trap_panic(tf, mcause);
+
+  TRACE_ENTER(fn);
+  tf = fn(tf);
+  TRACE_EXIT(fn);
+  return tf;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// trap frame layout, shared with trap.S
+// slot i holds register xi (slot 0 is unused, slot 2 is the sp at the
+// time of the trap), followed by mepc and mstatus
+#define TF_MEPC     32
+#define TF_MSTATUS  33
+#define TF_NSLOTS   34
+#define TF_SIZE     (TF_NSLOTS * 8)
+
+#ifndef __ASSEMBLER__
+#include "types.h"
+
+struct trapframe {
+  u64 x[32];
+  u64 mepc;
+  u64 mstatus;
+};
+
+// a handler gets the frame of the interrupted context and returns the
+// frame to resume, which lets the scheduler switch threads on the way out
+typedef struct trapframe *(*trap_handler_t)(struct trapframe *tf);
+
+void trap_init(void);
+void trap_register_irq(unsigned irq, trap_handler_t fn);
+void trap_register_exc(unsigned exc, trap_handler_t fn);
+
+// entry point written into mtvec, see trap.S
+void trap_entry(void);
+#endif
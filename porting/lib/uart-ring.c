@@ -0,0 +1,52 @@
+#include "uart-ring.h"
+#include "sections.h"
+
+void uart_ring_init(struct uart_ring *r, volatile struct uart *uart, u8 *buf,
+                    u32 size) {
+  r->uart = uart;
+  r->buf = buf;
+  r->mask = size - 1;
+  r->head = r->tail = 0;
+  r->hwm = 0;
+}
+
+__hot_text unsigned uart_ring_pump(struct uart_ring *r) {
+  unsigned n = 0;
+
+  while (uart_ring_count(r) <= r->mask && uart_can_getc(r->uart)) {
+    r->buf[r->head & r->mask] = uart_getc(r->uart);
+    r->head++;
+    n++;
+  }
+  if (uart_ring_count(r) > r->hwm)
+    r->hwm = uart_ring_count(r);
+  return n;
+}
+
+__hot_text u8 uart_ring_getc(struct uart_ring *r) {
+  while (!uart_ring_count(r))
+    uart_ring_pump(r);
+  return r->buf[r->tail++ & r->mask];
+}
+
+__hot_text void uart_ring_read(struct uart_ring *r, void *dst, u32 n) {
+  u8 *d = dst;
+
+  while (n) {
+    uart_ring_pump(r);
+
+    // copy the contiguous run up to the wrap point
+    u32 avail = uart_ring_count(r);
+    u32 off = r->tail & r->mask;
+    u32 run = r->mask + 1 - off;
+    if (run > avail)
+      run = avail;
+    if (run > n)
+      run = n;
+    for (u32 i = 0; i < run; i++)
+      d[i] = r->buf[off + i];
+    d += run;
+    r->tail += run;
+    n -= run;
+  }
+}
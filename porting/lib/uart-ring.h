@@ -0,0 +1,35 @@
+#pragma once
+
+#include "types.h"
+#include "uart.h"
+
+// software receive ring behind a uart's 32 byte rx fifo. at 2 Mbaud
+// that fifo is full after 160us, so a loop that does real work on the
+// data (crc, copies, decompression) should read through one of these
+// and call uart_ring_pump at least that often.
+//
+// single consumer, and pump is only called from the consumer's
+// context, so there is no locking.
+struct uart_ring {
+  volatile struct uart *uart;
+  u8 *buf;
+  u32 mask; // size - 1, size is a power of two
+  u32 head; // free running, advanced by pump
+  u32 tail; // free running, advanced by the readers
+  u32 hwm;  // most bytes ever queued
+};
+
+void uart_ring_init(struct uart_ring *r, volatile struct uart *uart, u8 *buf,
+                    u32 size);
+
+// move whatever the fifo holds into the ring, returns bytes moved.
+// stops early when the ring is full and leaves the rest in the fifo
+unsigned uart_ring_pump(struct uart_ring *r);
+
+static inline u32 uart_ring_count(const struct uart_ring *r) {
+  return r->head - r->tail;
+}
+
+// both pump while they wait
+u8 uart_ring_getc(struct uart_ring *r);
+void uart_ring_read(struct uart_ring *r, void *dst, u32 n);
@@ -1,8 +1,10 @@
 #include <stdbool.h>
 
 #include "memory.h"
+#include "sections.h"
 #include "types.h"
 #include "uart.h"
+#include "uartmux.h"
 
 // from the bl808 reference manual
 struct uart {
@@ -39,29 +41,36 @@ volatile struct uart *const UART0 = (volatile struct uart *)0x2000A000;
 volatile struct uart *const UART1 = (volatile struct uart *)0x2000A100;
 volatile struct uart *const UART2 = (volatile struct uart *)0x2000AA00;
 
-#define UART_CLOCK 40000000UL
+// uart_clk is the 80 MHz mcu_pbclk, not the 40 MHz xtal; that is the
+// factor of 2 uart_init used to fudge in
+#define UART_CLOCK 80000000UL
 
-bool uart_can_getc(volatile struct uart *uart) {
+__hot_text bool uart_can_getc(volatile struct uart *uart) {
   return ((get32(&uart->fifo_config_1) >> 8) & 0x3f) != 0;
 }
 
-char uart_getc(volatile struct uart *uart) {
+__hot_text char uart_getc(volatile struct uart *uart) {
   while (!uart_can_getc(uart))
     ;
   return get32(&uart->fifo_rdata);
 }
 
-bool uart_can_putc(volatile struct uart *uart) {
-  return (get32(&uart->fifo_config_1) & 0x3f) != 0;
+__hot_text bool uart_can_putc(volatile struct uart *uart) {
+  return uart_tx_free(uart) != 0;
 }
 
-void uart_putc(volatile struct uart *uart, char c) {
+// free entries in the tx fifo
+__hot_text unsigned uart_tx_free(volatile struct uart *uart) {
+  return get32(&uart->fifo_config_1) & 0x3f;
+}
+
+__hot_text void uart_putc(volatile struct uart *uart, char c) {
   while (!uart_can_putc(uart))
     ;
   put32(&uart->fifo_wdata, c);
 }
 
-void uart_puts(volatile struct uart *uart, const char *c) {
+__hot_text void uart_puts(volatile struct uart *uart, const char *c) {
   while (*c) {
     uart_putc(uart, *c++);
   }
@@ -75,13 +84,52 @@ void uart_puthex64(uint64_t val) {
     }
 }
 
-void uart_init(volatile struct uart *uart, unsigned baud) {
+void uart_putdec(volatile struct uart *uart, uint64_t val) {
+  char buf[20];
+  int n = 0;
+  do {
+    buf[n++] = '0' + val % 10;
+    val /= 10;
+  } while (val);
+  while (n)
+    uart_putc(uart, buf[--n]);
+}
+
+bool uart_baud_calc(unsigned baud, struct uart_baud *b) {
+  if (baud == 0)
+    return false;
+
+  // bit_prd holds the period minus one, rounded to the nearest clock
+  u32 period = (UART_CLOCK + baud / 2) / baud;
+  if (period < 2 || period > 0x10000)
+    return false;
+
+  b->divisor = period - 1;
+  b->actual = (UART_CLOCK + period / 2) / period;
+  b->error_ppm = ((i64)b->actual - baud) * 1000000 / (i64)baud;
+  return b->error_ppm <= UART_BAUD_MAX_ERROR_PPM &&
+         b->error_ppm >= -UART_BAUD_MAX_ERROR_PPM;
+}
+
+bool uart_configure(volatile struct uart *uart, const struct uart_config *cfg) {
+  struct uart_baud b;
+  if (!uart_baud_calc(cfg->baud, &b))
+    return false;
+
+  // flow control needs somewhere for the handshake lines to go
+  if (cfg->flow_control &&
+      (uart_routed_pin(uart, UARTMUX_RTS) == UART_NOPIN ||
+       uart_routed_pin(uart, UARTMUX_CTS) == UART_NOPIN))
+    return false;
+
   // p302
   uint32_t tx = 0;
   tx |= 1 << 0;  // enable
   tx |= 1 << 2;  // freerun mode
   tx |= 7 << 8;  // 8 data bits
   tx |= 2 << 11; // 1 stop bit
+  if (cfg->flow_control)
+    tx |= 1 << 1; // only send while cts is low
   put32(&uart->tx_config, tx);
 
   uint32_t rx = 0;
@@ -89,9 +137,39 @@ void uart_init(volatile struct uart *uart, unsigned baud) {
   rx |= 7 << 8; // 8 data bits
   put32(&uart->rx_config, rx);
 
-  uint32_t bit_period_value =
-      (2 * UART_CLOCK / baud) - 1; // for some reason the uart clock seems to be
-                                   // off by a factor of 2 from what we expect
-  uint32_t val = bit_period_value << 16 | bit_period_value;
-  put32(&uart->bit_prd, val);
+  // with the rts software override off, the receiver drives rts
+  // itself and deasserts it when its fifo fills up
+  if (cfg->flow_control)
+    put32(&uart->sw_mode, get32(&uart->sw_mode) & ~(1 << 2));
+
+  put32(&uart->bit_prd, b.divisor << 16 | b.divisor);
+
+  // the fifo interrupts fire while more than th entries are free (tx)
+  // or queued (rx)
+  uint32_t fifo = get32(&uart->fifo_config_1);
+  fifo &= ~(0x1f << 16 | 0x1f << 24);
+  fifo |= (cfg->tx_fifo_th & 0x1f) << 16;
+  fifo |= (cfg->rx_fifo_th & 0x1f) << 24;
+  put32(&uart->fifo_config_1, fifo);
+
+  // counted in bit times of idle line after the last byte
+  put32(&uart->rx_rto_timer, cfg->rx_timeout & 0xff);
+
+  put32(&uart->int_clear, UART_INT_ALL);
+  put32(&uart->int_en, cfg->ints);
+  put32(&uart->int_mask, ~cfg->ints & UART_INT_ALL);
+  return true;
+}
+
+bool uart_init(volatile struct uart *uart, unsigned baud) {
+  struct uart_config cfg = UART_CONFIG_DEFAULT(baud);
+  return uart_configure(uart, &cfg);
+}
+
+uint32_t uart_int_status(volatile struct uart *uart) {
+  return get32(&uart->int_sts);
+}
+
+void uart_int_clear(volatile struct uart *uart, uint32_t ints) {
+  put32(&uart->int_clear, ints);
 }
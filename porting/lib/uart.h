@@ -10,7 +10,62 @@ extern volatile struct uart *const UART2;
 bool uart_can_getc(volatile struct uart *uart);
 char uart_getc(volatile struct uart *uart);
 bool uart_can_putc(volatile struct uart *uart);
+unsigned uart_tx_free(volatile struct uart *uart);
 void uart_putc(volatile struct uart *uart, char c);
 void uart_puts(volatile struct uart *uart, const char *c);
 void uart_puthex64(uint64_t val);
-void uart_init(volatile struct uart *uart, unsigned baud);
+void uart_putdec(volatile struct uart *uart, uint64_t val);
+bool uart_init(volatile struct uart *uart, unsigned baud);
+
+// uart_init(uart, baud) is uart_configure with UART_CONFIG_DEFAULT:
+// 8N1, no flow control, no interrupts. false, with the uart left as it
+// was, if the baud rate can't be made. everything below is for when
+// you want more than that.
+
+// int_sts/int_en/int_mask/int_clear bits, pg 420-423
+#define UART_INT_TX_END   (1U << 0) // tx length reached
+#define UART_INT_RX_END   (1U << 1)
+#define UART_INT_TX_FIFO  (1U << 2) // more than tx_fifo_th entries free
+#define UART_INT_RX_FIFO  (1U << 3) // more than rx_fifo_th entries queued
+#define UART_INT_RX_RTO   (1U << 4) // rx line idle for rx_timeout bits
+#define UART_INT_RX_PCE   (1U << 5) // parity error
+#define UART_INT_TX_FER   (1U << 6) // tx fifo over/underflow
+#define UART_INT_RX_FER   (1U << 7) // rx fifo overflow: bytes were lost
+#define UART_INT_ALL      0xffU
+
+// uart_configure refuses a baud rate the divider can't hit within this
+#define UART_BAUD_MAX_ERROR_PPM 20000
+
+struct uart_config {
+  unsigned baud;
+  // hardware RTS/CTS. route the rts and cts pins with uart_route
+  // first, or uart_configure fails
+  bool flow_control;
+  unsigned tx_fifo_th; // 0..31, fifos are 32 deep
+  unsigned rx_fifo_th;
+  unsigned rx_timeout; // bit times, 0..255
+  // UART_INT_* raised on the uart's interrupt. nothing in lib hooks
+  // that up to the plic: the rx path (uart_ring) is polling only and
+  // reads the same bits through uart_int_status
+  uint32_t ints;
+};
+
+#define UART_CONFIG_DEFAULT(b) \
+  { .baud = (b), .flow_control = false, .tx_fifo_th = 0, .rx_fifo_th = 0, \
+    .rx_timeout = 0, .ints = 0 }
+
+struct uart_baud {
+  uint32_t divisor; // what goes into bit_prd
+  uint32_t actual;
+  int32_t error_ppm; // actual vs asked for
+};
+
+// false if baud is out of range or off by more than
+// UART_BAUD_MAX_ERROR_PPM; b is filled in either way when in range
+bool uart_baud_calc(unsigned baud, struct uart_baud *b);
+bool uart_configure(volatile struct uart *uart, const struct uart_config *cfg);
+
+// the status bits are set whether or not the interrupt is enabled, so
+// polling UART_INT_RX_FER is how to notice an overrun
+uint32_t uart_int_status(volatile struct uart *uart);
+void uart_int_clear(volatile struct uart *uart, uint32_t ints);
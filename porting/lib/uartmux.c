@@ -1,5 +1,6 @@
 #include "uartmux.h"
 #include "memory.h"
+#include "types.h"
 
 static volatile uint32_t *const uartmux_signal =
     (volatile uint32_t *)0x20000154;
@@ -16,3 +17,126 @@ void uartmux_configure(size_t signal, size_t uart,
   value |= (fn & 0b1111) << shift;
   put32(reg, value);
 }
+
+// who has each mux signal: the pin it is routed to and the value in
+// the mux register (uart * 4 + function), -1 when free
+static struct {
+  i8 pin;
+  i8 fn;
+} owners[UARTMUX_NSIGNALS] = {
+    [0 ... UARTMUX_NSIGNALS - 1] = {UART_NOPIN, -1},
+};
+static bool seeded;
+
+// take over whatever the boot rom or an earlier stage routed, so the
+// console pins can't be handed to someone else: a signal is in use when
+// a pin on it is set to the uart function
+static void seed(void) {
+  if (seeded)
+    return;
+  seeded = true;
+  for (int pin = 0; pin < GPIO_NPINS; pin++) {
+    size_t sig = uartmux_signal_number(pin);
+    if (owners[sig].fn >= 0)
+      continue;
+    gpio_cfg_t cfg = get32_type(gpio_cfg_t, GPIO_CFG0 + pin);
+    if (cfg.func_sel != GPIO_FUNC_UART0)
+      continue;
+    unsigned fn = (get32(uartmux_signal + sig / 8) >> ((sig % 8) * 4)) & 0xf;
+    if (fn >= 3 * 4) // not a uart0-2 function
+      continue;
+    owners[sig].pin = pin;
+    owners[sig].fn = fn;
+  }
+}
+
+static int uart_number(volatile struct uart *uart) {
+  if (uart == UART0)
+    return 0;
+  if (uart == UART1)
+    return 1;
+  if (uart == UART2)
+    return 2;
+  return -1;
+}
+
+static void release(int n) {
+  for (unsigned sig = 0; sig < UARTMUX_NSIGNALS; sig++) {
+    if (owners[sig].fn >= 0 && owners[sig].fn / 4 == n) {
+      // park the pin back on plain gpio so it stops driving
+      gpio_set_function(owners[sig].pin, GPIO_FUNC_GPIO);
+      owners[sig].pin = UART_NOPIN;
+      owners[sig].fn = -1;
+    }
+  }
+}
+
+int uart_route(volatile struct uart *uart, int tx_pin, int rx_pin, int rts_pin,
+               int cts_pin) {
+  int n = uart_number(uart);
+  if (n < 0)
+    return UART_ROUTE_EINVAL;
+  seed();
+
+  const int pins[] = {
+      [UARTMUX_RTS] = rts_pin,
+      [UARTMUX_CTS] = cts_pin,
+      [UARTMUX_TX] = tx_pin,
+      [UARTMUX_RX] = rx_pin,
+  };
+
+  // check everything before touching anything
+  for (unsigned f = 0; f < 4; f++) {
+    int pin = pins[f];
+    if (pin == UART_NOPIN)
+      continue;
+    if (pin < 0 || pin >= GPIO_NPINS)
+      return UART_ROUTE_EINVAL;
+
+    size_t sig = uartmux_signal_number(pin);
+    for (unsigned g = 0; g < f; g++)
+      if (pins[g] != UART_NOPIN &&
+          (pins[g] == pin || uartmux_signal_number(pins[g]) == sig))
+        return UART_ROUTE_EINVAL;
+    if (owners[sig].fn >= 0 && owners[sig].fn / 4 != n)
+      return UART_ROUTE_EBUSY;
+  }
+  // a pin of another uart that sits on a free signal can't happen,
+  // every routed pin owns its signal
+
+  release(n);
+  for (unsigned f = 0; f < 4; f++) {
+    int pin = pins[f];
+    if (pin == UART_NOPIN)
+      continue;
+
+    size_t sig = uartmux_signal_number(pin);
+    owners[sig].pin = pin;
+    owners[sig].fn = n * 4 + f;
+    uartmux_configure(sig, n, f);
+
+    // inputs need the receiver on, and an open line should idle high
+    if (f == UARTMUX_RX || f == UARTMUX_CTS)
+      gpio_set_input(pin);
+    gpio_set_pullup(pin);
+    gpio_set_function(pin, GPIO_FUNC_UART0);
+  }
+  return UART_ROUTE_OK;
+}
+
+void uart_unroute(volatile struct uart *uart) {
+  int n = uart_number(uart);
+  seed();
+  if (n >= 0)
+    release(n);
+}
+
+int uart_routed_pin(volatile struct uart *uart,
+                    enum uartmux_function function) {
+  int n = uart_number(uart);
+  seed();
+  for (unsigned sig = 0; sig < UARTMUX_NSIGNALS; sig++)
+    if (n >= 0 && owners[sig].fn == n * 4 + (int)function)
+      return owners[sig].pin;
+  return UART_NOPIN;
+}
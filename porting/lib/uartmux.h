@@ -1,5 +1,6 @@
 #pragma once
 #include "gpio.h"
+#include "uart.h"
 #include <stddef.h>
 #include <stdint.h>
 
@@ -13,3 +14,29 @@ enum uartmux_function {
 size_t uartmux_signal_number(int pin);
 void uartmux_configure(size_t signal, size_t uart,
                        enum uartmux_function function);
+
+#define UARTMUX_NSIGNALS 12
+
+// no pin for this function
+#define UART_NOPIN (-1)
+
+enum {
+  UART_ROUTE_OK = 0,
+  UART_ROUTE_EINVAL = -1, // bad uart or pin, or one pin given twice
+  UART_ROUTE_EBUSY = -2,  // pin % 12 is already routed for someone else
+};
+
+// route a hardware uart to pins: function 7 on each pin, the mux
+// signal (pin % 12) set to the uart's function. rts and cts may be
+// UART_NOPIN. every signal carries one function of one uart, so two
+// pins that are equal mod 12 can't serve different functions; that,
+// and pins already routed by another uart, are refused with nothing
+// changed. routing a uart again replaces its old pins. on first use the
+// table picks up the routes already in place (the console from the
+// boot rom), so those pins count as taken by their uart too.
+int uart_route(volatile struct uart *uart, int tx_pin, int rx_pin, int rts_pin,
+               int cts_pin);
+void uart_unroute(volatile struct uart *uart);
+
+// the pin a uart function is routed to, UART_NOPIN if none
+int uart_routed_pin(volatile struct uart *uart, enum uartmux_function function);
@@ -0,0 +1,217 @@
+#include "wave.h"
+#include "clint.h"
+#include "csr.h"
+#include "gpio.h"
+#include "sections.h"
+#include "trap.h"
+
+// time from reading the start stamp to the first deadline, so the
+// first edge isn't late just because we set things up
+#define LEAD_CYCLES 64
+
+void wave_init(struct wave *w, struct wave_step *buf, u32 cap,
+               unsigned carrier_hz) {
+  w->steps = buf;
+  w->cap = cap;
+  w->carrier_hz = carrier_hz;
+  wave_clear(w);
+}
+
+void wave_clear(struct wave *w) {
+  w->n = 0;
+  w->overflow = false;
+}
+
+bool wave_push(struct wave *w, unsigned level, u32 cycles) {
+  level = level ? 1 : 0;
+  if (cycles == 0)
+    return true;
+  if (w->n && w->steps[w->n - 1].level == level) {
+    w->steps[w->n - 1].cycles += cycles;
+    return true;
+  }
+  if (w->n == w->cap) {
+    w->overflow = true;
+    return false;
+  }
+  w->steps[w->n].level = level;
+  w->steps[w->n].cycles = cycles;
+  w->n++;
+  return true;
+}
+
+#define NEC_UNIT WAVE_NS(562500)
+
+static bool nec_byte(struct wave *w, u8 b) {
+  bool ok = true;
+  for (unsigned i = 0; i < 8; i++, b >>= 1) {
+    ok &= wave_mark(w, NEC_UNIT);
+    ok &= wave_space(w, (b & 1) ? 3 * NEC_UNIT : NEC_UNIT);
+  }
+  return ok;
+}
+
+bool wave_nec(struct wave *w, u8 addr, u8 cmd) {
+  bool ok = wave_mark(w, 16 * NEC_UNIT);
+  ok &= wave_space(w, 8 * NEC_UNIT);
+  ok &= nec_byte(w, addr);
+  ok &= nec_byte(w, ~addr);
+  ok &= nec_byte(w, cmd);
+  ok &= nec_byte(w, ~cmd);
+  ok &= wave_mark(w, NEC_UNIT);
+  return ok;
+}
+
+#define RC5_HALF WAVE_US(889)
+
+bool wave_rc5(struct wave *w, bool toggle, u8 addr, u8 cmd) {
+  // S1, S2 (inverted cmd bit 6), T, A4..A0, C5..C0
+  u32 bits = 1 << 13 | !(cmd & 0x40) << 12 | toggle << 11 |
+             (addr & 0x1f) << 6 | (cmd & 0x3f);
+  bool ok = true;
+  for (int i = 13; i >= 0; i--) {
+    // a one is space then mark, a zero mark then space
+    unsigned one = (bits >> i) & 1;
+    ok &= wave_push(w, !one, RC5_HALF);
+    ok &= wave_push(w, one, RC5_HALF);
+  }
+  return ok;
+}
+
+bool wave_raw(struct wave *w, const u32 *us, u32 n) {
+  bool ok = true;
+  for (u32 i = 0; i < n; i++)
+    ok &= wave_push(w, !(i & 1), WAVE_US(us[i]));
+  return ok;
+}
+
+u64 wave_cycles(const struct wave *w) {
+  u64 total = 0;
+  for (u32 i = 0; i < w->n; i++)
+    total += w->steps[i].cycles;
+  return total;
+}
+
+static inline u64 wait_until(u64 deadline) {
+  u64 now;
+  while ((i64)((now = cycle_cnt_read()) - deadline) < 0)
+    ;
+  return now;
+}
+
+static inline void note(struct wave_stats *st, u64 late) {
+  st->edges++;
+  st->sum_late += late;
+  if (late > st->max_late)
+    st->max_late = late;
+}
+
+// runs from WRAM, a PSRAM cache miss in here is an edge out of place
+__hot_text void wave_play(const struct wave *w, unsigned pin,
+                          struct wave_stats *st) {
+  struct wave_stats local = {0};
+  gpio_fast_t p = gpio_fast_output(pin);
+
+  // carrier edge k of a mark is at k * cps / (2 * hz) from its start
+  u64 cps = cycle_cnt_hz();
+  u64 half_den = 2 * (u64)w->carrier_hz;
+
+  u64 flags = irq_save();
+  u64 t = cycle_cnt_read() + LEAD_CYCLES;
+
+  for (u32 i = 0; i < w->n; i++) {
+    const struct wave_step *s = &w->steps[i];
+    u64 end = t + s->cycles;
+
+    if (s->level && half_den) {
+      for (u64 k = 0;; k++) {
+        u64 edge = t + k * cps / half_den;
+        if (edge >= end)
+          break;
+        u64 now = wait_until(edge);
+        gpio_fast_write(p, !(k & 1));
+        note(&local, now - edge);
+      }
+    } else {
+      u64 now = wait_until(t);
+      gpio_fast_write(p, s->level);
+      note(&local, now - t);
+    }
+    t = end;
+  }
+
+  // the last step runs to its end before the pin goes idle
+  u64 now = wait_until(t);
+  gpio_fast_off(p);
+  note(&local, now - t);
+  irq_restore(flags);
+
+  local.drift = now - t;
+  if (st)
+    *st = local;
+}
+
+static const struct wave *send_wave __fast_bss;
+static pwm_gate_t send_gate __fast_bss;
+static u32 send_step __fast_bss;
+static u64 send_start __fast_bss;   // mtime ticks
+static u64 send_elapsed __fast_bss; // cycles up to send_step
+static u64 send_cps __fast_bss;     // cycle_cnt_hz() at wave_send
+static volatile bool sending __fast_bss;
+
+// mtime of the boundary after step i - 1, rounded to the nearest tick
+static inline u64 boundary(u64 cycles) {
+  return send_start + (cycles * CLINT_TIMER_HZ + send_cps / 2) / send_cps;
+}
+
+__hot_text static struct trapframe *send_tick(struct trapframe *tf) {
+  const struct wave *w = send_wave;
+
+  // a late interrupt can owe more than one boundary, catch up
+  while (send_step < w->n && (i64)(clint_mtime() - boundary(send_elapsed)) >= 0) {
+    pwm_gate_write(send_gate, w->steps[send_step].level);
+    send_elapsed += w->steps[send_step].cycles;
+    send_step++;
+  }
+
+  if (send_step < w->n || (i64)(clint_mtime() - boundary(send_elapsed)) < 0) {
+    clint_set_timecmp(hart_id(), boundary(send_elapsed));
+    return tf;
+  }
+
+  // past the end of the last step
+  pwm_gate_off(send_gate);
+  clint_timer_disarm();
+  csr_clear(mie, MIE_MTIE);
+  sending = false;
+  return tf;
+}
+
+bool wave_send(const struct wave *w, pwm_gate_t gate) {
+  static bool ready;
+
+  if (sending)
+    return false;
+  if (!ready) {
+    clint_init();
+    ready = true;
+  }
+
+  send_wave = w;
+  send_gate = gate;
+  send_step = 0;
+  send_elapsed = 0;
+  send_cps = cycle_cnt_hz();
+  sending = true;
+
+  trap_register_irq(IRQ_M_TIMER, send_tick);
+  // one tick out, so the first boundary is a normal interrupt
+  send_start = clint_mtime() + 1;
+  clint_set_timecmp(hart_id(), send_start);
+  csr_set(mie, MIE_MTIE);
+  return true;
+}
+
+bool wave_sending(void) {
+  return sending;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "cycle-counter.h"
+#include "pwm.h"
+#include "types.h"
+
+// table driven waveform output. a frame is built once as a list of
+// (level, cycles) steps and then replayed against absolute deadlines:
+// every edge is due at start + the sum of everything before it, so
+// the time spent writing the pin and looping never adds up. marks
+// (level 1) are optionally modulated with a 50% carrier, whose edges
+// are on the same absolute grid (k * period / 2 from the mark start,
+// no rounding carried from one period to the next).
+//
+//   struct wave_step buf[128];
+//   struct wave w;
+//   wave_init(&w, buf, 128, 38000);
+//   wave_nec(&w, 0x00, 0x48);
+//   wave_play(&w, 17, 0);
+
+#define WAVE_US(us) ((u32)((u64)(us) * cycle_cnt_hz() / 1000000))
+#define WAVE_NS(ns) ((u32)((u64)(ns) * cycle_cnt_hz() / 1000000000))
+
+struct wave_step {
+  u32 level;
+  u32 cycles;
+};
+
+struct wave {
+  struct wave_step *steps;
+  u32 n;
+  u32 cap;
+  unsigned carrier_hz; // 0 = marks are a steady high
+  bool overflow;       // a push didn't fit, the frame is cut short
+};
+
+void wave_init(struct wave *w, struct wave_step *buf, u32 cap,
+               unsigned carrier_hz);
+void wave_clear(struct wave *w);
+
+// append a step, merged into the last one if the level is the same.
+// false (and overflow set) if it didn't fit
+bool wave_push(struct wave *w, unsigned level, u32 cycles);
+
+static inline bool wave_mark(struct wave *w, u32 cycles) {
+  return wave_push(w, 1, cycles);
+}
+
+static inline bool wave_space(struct wave *w, u32 cycles) {
+  return wave_push(w, 0, cycles);
+}
+
+// protocol frames, appended to whatever is already in w. the carrier
+// comes from wave_init: 38 kHz for NEC, 36 kHz for RC5.
+//
+// NEC: 9ms/4.5ms leader, addr, ~addr, cmd, ~cmd lsb first, stop mark
+bool wave_nec(struct wave *w, u8 addr, u8 cmd);
+// RC5: two start bits, toggle, 5 bit address, 6 bit command, msb
+// first, manchester coded with 889us half bits. cmd bit 6 goes into
+// the second start bit (RC5X)
+bool wave_rc5(struct wave *w, bool toggle, u8 addr, u8 cmd);
+// lirc style raw timings in us, mark first, then alternating
+bool wave_raw(struct wave *w, const u32 *us, u32 n);
+
+// how well the replay kept to its deadlines, all in cycles. late is
+// how long after its deadline an edge was written; drift is where the
+// last edge ended up against where the table says it should be
+struct wave_stats {
+  u32 edges;
+  u64 max_late;
+  u64 sum_late;
+  i64 drift;
+};
+
+// replays w on pin with interrupts off, and leaves it low. the pin is
+// switched to the gpio set/clr fast path. st may be null
+void wave_play(const struct wave *w, unsigned pin, struct wave_stats *st);
+
+// total length of the frame in cycles
+u64 wave_cycles(const struct wave *w);
+
+// hardware carrier version: the PWM group already runs the carrier
+// (pwm_init at carrier_hz, pwm_attach the pin) and every step boundary
+// just gates it, from the CLINT timer interrupt. wave_send returns
+// right away; the core is free except for a few hundred cycles per
+// boundary. deadlines are on the 1us mtime grid from one start time,
+// so the error stays under a tick and doesn't add up.
+//
+// owns the machine timer interrupt while sending, so not together
+// with sched or prof. needs trap_init and interrupts on. w must stay
+// put until wave_sending() goes false; false if a frame is still out
+bool wave_send(const struct wave *w, pwm_gate_t gate);
+bool wave_sending(void);
@@ -0,0 +1,46 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// gpio logic analyzer. records every edge on PINS for SECONDS and
+// streams them out on UART0 while it runs. an IR receiver on pin 17
+// shows the frames bb.c sends. capture the uart and convert:
+//   tools/capture-vcd.py --port /dev/ttyUSB1 --name 17=ir > ir.vcd
+//   gtkwave ir.vcd
+
+#define PINS     ((1ULL << 17) | (1ULL << 18))
+#define SECONDS  10
+#define NEDGES   4096
+
+static capture_edge_t edges[NEDGES];
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "logic-capture\r\n");
+    // the stream header and the window below both go by cycle_cnt_hz
+    bench_put(UART0, "cpu hz: ", cycle_cnt_calibrate(UART0, 115200), "\r\n");
+
+    trap_init();
+    plic_init();
+    for (uint64_t m = PINS; m; m &= m - 1) {
+        gpio_set_input(__builtin_ctzll(m));
+        gpio_set_pullup(__builtin_ctzll(m));
+    }
+
+    capture_init(edges, NEDGES);
+    capture_start(PINS);
+    irq_enable();
+
+    capture_stream_begin(UART0);
+    uint64_t end = cycle_cnt_read() + SECONDS * cycle_cnt_hz();
+    while ((int64_t)(cycle_cnt_read() - end) < 0)
+        capture_stream_pump(UART0);
+    capture_stop();
+    capture_stream_end(UART0);
+
+    uart_puts(UART0, "\r\ndropped: ");
+    uart_putdec(UART0, capture_dropped());
+    uart_puts(UART0, "\r\n");
+
+    while (1)
+        asm volatile("wfi");
+}
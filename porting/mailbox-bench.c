@@ -0,0 +1,147 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// throughput and round trip of the mailbox rings. first both ends run
+// on this hart, which is the software cost of the ring itself: batched
+// sends/receives for messages/sec, and a ping/pong over two rings for
+// the round trip. if a second hart is online (qemu -smp) the pong side
+// moves there and the same numbers are taken across harts.
+
+#define NMSGS   (64 * 1024)
+#define BATCH   16
+#define NPINGS  1024
+
+static struct mbox_ring ping __ipc;
+static struct mbox_ring pong __ipc;
+
+static void bench_throughput(void) {
+    struct mbox_msg batch[BATCH];
+    struct mbox_msg out[BATCH];
+    uint64_t sum = 0;
+
+    for (unsigned i = 0; i < BATCH; i++)
+        batch[i] = (struct mbox_msg){ .type = 1, .len = 0, .arg = i };
+
+    uint64_t start = cycle_cnt_read();
+    for (unsigned sent = 0; sent < NMSGS; sent += BATCH) {
+        mbox_send_batch(&ping, batch, BATCH);
+        unsigned n = mbox_recv_batch(&ping, out, BATCH);
+        for (unsigned i = 0; i < n; i++)
+            sum += out[i].arg;
+    }
+    uint64_t cycles = cycle_cnt_read() - start;
+
+    bench_put(UART0, "msgs:              ", ping.received, "\r\n");
+    bench_put(UART0, "batches:           ", ping.batches, "\r\n");
+    bench_put(UART0, "cycles per msg:    ", cycles / NMSGS, "\r\n");
+    bench_put(UART0, "msgs per sec:      ",
+              NMSGS * cycle_cnt_hz() / cycles, "\r\n");
+    bench_put(UART0, "checksum:          ", sum, "\r\n");
+}
+
+static void bench_round_trip(void) {
+    struct mbox_msg m = { .type = 2 };
+    uint64_t best = ~0ULL, total = 0;
+
+    for (unsigned i = 0; i < NPINGS; i++) {
+        m.arg = i;
+        uint64_t start = cycle_cnt_read();
+        mbox_send(&ping, &m);
+        mbox_recv(&ping, &m);
+        mbox_send(&pong, &m);
+        mbox_recv(&pong, &m);
+        uint64_t rtt = cycle_cnt_read() - start;
+
+        total += rtt;
+        if (rtt < best)
+            best = rtt;
+    }
+    bench_put(UART0, "rtt min cycles:    ", best, "\r\n");
+    bench_put(UART0, "rtt avg cycles:    ", total / NPINGS, "\r\n");
+}
+
+// runs on hart 1: bounce every ping back, sleeping on the doorbell
+// when idle. type 0 tells it to stop.
+static void pong_server(void *arg) {
+    struct mbox_msg m[BATCH];
+
+    while (1) {
+        unsigned n = mbox_recv_batch(&ping, m, BATCH);
+        if (n == 0) {
+            mbox_wait(&ping);
+            continue;
+        }
+        for (unsigned i = 0; i < n; i++) {
+            if (m[i].type == 0)
+                return;
+            while (!mbox_send(&pong, &m[i]))
+                ;
+        }
+    }
+}
+
+static void bench_cross_hart(unsigned peer) {
+    struct mbox_msg m = { .type = 2 };
+    struct mbox_msg back;
+    uint64_t best = ~0ULL, total = 0;
+
+    mbox_init(&ping, peer);
+    mbox_init(&pong, hart_id());
+    smp_call_on(peer, pong_server, 0);
+
+    for (unsigned i = 0; i < NPINGS; i++) {
+        m.arg = i;
+        uint64_t start = cycle_cnt_read();
+        while (!mbox_send(&ping, &m))
+            ;
+        while (!mbox_recv(&pong, &back))
+            ;
+        uint64_t rtt = cycle_cnt_read() - start;
+
+        total += rtt;
+        if (rtt < best)
+            best = rtt;
+    }
+    bench_put(UART0, "xhart rtt min:     ", best, "\r\n");
+    bench_put(UART0, "xhart rtt avg:     ", total / NPINGS, "\r\n");
+    bench_put(UART0, "doorbells:         ", ping.doorbells, "\r\n");
+
+    // streaming: keep the ring full and drain the echoes as they come
+    uint64_t start = cycle_cnt_read();
+    unsigned sent = 0, got = 0;
+    struct mbox_msg batch[BATCH], out[BATCH];
+    for (unsigned i = 0; i < BATCH; i++)
+        batch[i] = m;
+    while (got < NMSGS) {
+        if (sent < NMSGS)
+            sent += mbox_send_batch(&ping, batch, BATCH);
+        got += mbox_recv_batch(&pong, out, BATCH);
+    }
+    uint64_t cycles = cycle_cnt_read() - start;
+    bench_put(UART0, "xhart msgs per sec:",
+              NMSGS * cycle_cnt_hz() / cycles, "\r\n");
+
+    m.type = 0;
+    while (!mbox_send(&ping, &m))
+        ;
+    smp_wait(peer);
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "mailbox-bench\r\n");
+    bench_put(UART0, "cpu hz: ", cycle_cnt_calibrate(UART0, 115200), "\r\n");
+
+    mbox_init(&ping, hart_id());
+    mbox_init(&pong, hart_id());
+
+    bench_throughput();
+    bench_round_trip();
+
+    clint_init();
+    if (smp_init(10 * 1000) > 1 && smp_hart_online(1))
+        bench_cross_hart(1);
+
+    while (1)
+        asm volatile("wfi");
+}
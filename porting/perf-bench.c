@@ -0,0 +1,81 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// exercises lib/perf.h: walks a buffer at growing strides so the D-cache
+// and TLB counters move, runs a data dependent branch loop for the
+// mispredict counter, and samples the PC every so many L1D read misses
+// to show where they come from.
+
+#define BUF_SIZE (1024 * 1024)
+#define NWALKS   16
+
+static uint8_t buf[BUF_SIZE];
+static volatile uint64_t sink;
+
+#define NPCS 8
+
+static uint64_t miss_samples;
+static uint64_t miss_pcs[NPCS];
+
+static void walk(unsigned stride) {
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < BUF_SIZE; i += stride)
+        sum += buf[i];
+    sink = sum;
+}
+
+static void branchy(void) {
+    uint32_t x = 12345;
+    uint64_t n = 0;
+    for (unsigned i = 0; i < 64 * 1024; i++) {
+        x = x * 1664525 + 1013904223;
+        if (x & 0x80000000)
+            n++;
+    }
+    sink = n;
+}
+
+static void on_miss(unsigned slot, struct trapframe *tf) {
+    if (miss_samples < NPCS)
+        miss_pcs[miss_samples] = tf->mepc;
+    miss_samples++;
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "perf-bench\r\n");
+
+    trap_init();
+    perf_init();
+    perf_select(0, PERF_L1D_READ);
+    perf_select(1, PERF_L1D_READ_MISS);
+    perf_select(2, PERF_DUTLB_MISS);
+    perf_select(3, PERF_BR_MISPREDICT);
+
+    for (unsigned i = 0; i < NWALKS; i++) {
+        { PERF_SCOPE("walk stride 8"); walk(8); }
+        { PERF_SCOPE("walk stride 64"); walk(64); }
+        { PERF_SCOPE("walk stride 4096"); walk(4096); }
+        { PERF_SCOPE("branchy"); branchy(); }
+    }
+    perf_dump(UART0);
+
+    // every 1024th read miss, with interrupts on for the sampling
+    perf_sample_start(1, 1024, on_miss);
+    irq_enable();
+    for (unsigned i = 0; i < NWALKS; i++)
+        walk(64);
+    irq_disable();
+    perf_sample_stop(1);
+
+    bench_put(UART0, "miss samples:      ", miss_samples, "\r\n");
+    // look these up in perf-bench.list, they should all be in walk()
+    for (unsigned i = 0; i < NPCS && i < miss_samples; i++) {
+        uart_puts(UART0, "  pc ");
+        uart_puthex64(miss_pcs[i]);
+        uart_puts(UART0, "\r\n");
+    }
+
+    while (1)
+        asm volatile("wfi");
+}
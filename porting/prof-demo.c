@@ -0,0 +1,35 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// profiles a mix of console output and crc work at 10 kHz, then dumps
+// the samples. capture the uart and feed it to tools/prof.py:
+//   tools/prof.py prof-demo.list --port /dev/ttyUSB1 --flat > prof.folded
+
+#define NSAMPLES 8192
+#define RATE_HZ  10000
+
+static struct prof_sample samples[NSAMPLES];
+static uint8_t data[16 * 1024];
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "prof-demo\r\n");
+
+    prof_init(samples, NSAMPLES, RATE_HZ, true);
+    prof_start();
+
+    uint32_t crc = 0;
+    for (unsigned i = 0; i < 64; i++) {
+        uart_puts(UART0, "the quick brown fox jumps over the lazy dog\r\n");
+        crc = crc32_inc(data, sizeof(data), crc);
+    }
+
+    prof_stop();
+    uart_puts(UART0, "samples: ");
+    uart_putdec(UART0, prof_count());
+    uart_puts(UART0, "\r\n");
+    prof_dump(UART0);
+
+    while (1)
+        asm volatile("wfi");
+}
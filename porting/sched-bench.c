@@ -0,0 +1,75 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// N cpu-bound threads at the same priority spin until a shared
+// deadline, then main (idle priority) reports how evenly the cpu was
+// split and how long threads sat on the run queue.
+
+#define NTHREADS    4
+#define QUANTUM_US  1000
+#define RUN_US      (2 * 1000 * 1000)
+#define STACK_SIZE  4096
+
+static uint8_t stacks[NTHREADS][STACK_SIZE] __attribute__((aligned(16)));
+static volatile uint64_t work[NTHREADS];
+static volatile uint64_t deadline;
+
+static void spin(void *arg) {
+    unsigned i = (uintptr_t)arg;
+    while (clint_mtime() < deadline)
+        work[i]++;
+}
+
+static uint64_t cycles_to_us(uint64_t cycles) {
+    return cycles * 1000000 / cycle_cnt_hz();
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "sched-bench\r\n");
+    bench_put(UART0, "cpu hz: ", cycle_cnt_calibrate(UART0, 115200), "\r\n");
+
+    static const char *names[NTHREADS] = { "spin0", "spin1", "spin2", "spin3" };
+
+    sched_init(QUANTUM_US);
+    for (unsigned i = 0; i < NTHREADS; i++)
+        sched_spawn(names[i], spin, (void *)(uintptr_t)i, 1,
+                    stacks[i], STACK_SIZE);
+
+    deadline = clint_mtime() + RUN_US;
+    sched_start();
+
+    // everyone has exited by the time main gets the cpu back
+    uint64_t sum = 0, sumsq = 0;
+    for (unsigned i = 1; i <= NTHREADS; i++) {
+        struct thread *t = sched_thread(i);
+        uint64_t kcyc = t->cpu_cycles / 1000;
+        sum += kcyc;
+        sumsq += kcyc * kcyc;
+
+        uart_puts(UART0, t->name);
+        uart_puts(UART0, "\r\n");
+        bench_put(UART0, "  work:          ", work[i - 1], "\r\n");
+        bench_put(UART0, "  cpu us:        ",
+                  cycles_to_us(t->cpu_cycles), "\r\n");
+        bench_put(UART0, "  dispatches:    ", t->ndispatch, "\r\n");
+        bench_put(UART0, "  avg wait us:   ",
+                  cycles_to_us(t->wait_total / t->ndispatch), "\r\n");
+        bench_put(UART0, "  max wait us:   ",
+                  cycles_to_us(t->wait_max), "\r\n");
+    }
+
+    // jain's fairness index, 1000 == perfectly fair
+    bench_put(UART0, "fairness x1000:  ",
+              sum * sum * 1000 / (NTHREADS * sumsq), "\r\n");
+
+    const struct sched_stats *st = sched_get_stats();
+    bench_put(UART0, "ticks:           ", st->ticks, "\r\n");
+    bench_put(UART0, "switches:        ", st->switches, "\r\n");
+    bench_put(UART0, "avg tick late us:",
+              st->tick_latency_total / st->ticks, "\r\n");
+    bench_put(UART0, "max tick late us:", st->tick_latency_max, "\r\n");
+
+    while (1)
+        asm volatile("wfi");
+}
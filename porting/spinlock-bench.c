@@ -0,0 +1,112 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// lock contention benchmark, in two rounds.
+//
+// first NTHREADS scheduler threads on this hart hammer a shared
+// counter under each lock type. there the contention comes from
+// preemption: a thread preempted while holding a plain lock makes the
+// others spin out their quantum, which the _irqsave variants avoid by
+// keeping the timer off while the lock is held. a plain ticket lock is
+// left out of this round: once its holder is preempted every handoff
+// waits a full quantum (a lock convoy).
+//
+// then, if smp_init finds more harts (qemu -smp), every hart runs the
+// same worker at once for real cache-line contention.
+
+#define NTHREADS    4
+#define ITERS       20000
+#define QUANTUM_US  500
+#define STACK_SIZE  4096
+
+static uint8_t stacks[NTHREADS][STACK_SIZE] __attribute__((aligned(16)));
+static volatile uint64_t counter;
+
+static spinlock_t spin = SPINLOCK_INIT;
+static ticketlock_t ticket = TICKETLOCK_INIT;
+static rwlock_t rw = RWLOCK_INIT;
+static atomic64_t acount = ATOMIC_INIT(0);
+
+#define DEFINE_WORKER(name, lock, unlock) \
+    static void name(void *arg) { \
+        for (unsigned i = 0; i < ITERS; i++) { \
+            lock; \
+            counter++; \
+            unlock; \
+        } \
+    }
+
+DEFINE_WORKER(spin_worker, spin_lock(&spin), spin_unlock(&spin))
+DEFINE_WORKER(spin_irq_worker,
+              uint64_t f = spin_lock_irqsave(&spin),
+              spin_unlock_irqrestore(&spin, f))
+DEFINE_WORKER(ticket_worker, ticket_lock(&ticket), ticket_unlock(&ticket))
+DEFINE_WORKER(ticket_irq_worker,
+              uint64_t f = ticket_lock_irqsave(&ticket),
+              ticket_unlock_irqrestore(&ticket, f))
+DEFINE_WORKER(write_worker, write_lock(&rw), write_unlock(&rw))
+
+static void amo_worker(void *arg) {
+    for (unsigned i = 0; i < ITERS; i++)
+        atomic64_fetch_add(&acount, 1);
+}
+
+static void report(const char *name, uint64_t cycles, unsigned nworkers) {
+    uint64_t total = counter + atomic64_read(&acount);
+    uart_puts(UART0, name);
+    uart_puts(UART0, "\r\n");
+    bench_put(UART0, "  cycles per op: ", cycles / (nworkers * ITERS), "\r\n");
+    bench_put(UART0, "  count ok:      ", total == nworkers * ITERS, "\r\n");
+}
+
+static void run(const char *name, thread_fn_t fn) {
+    counter = 0;
+    atomic64_set(&acount, 0);
+
+    for (unsigned i = 0; i < NTHREADS; i++)
+        sched_spawn(name, fn, 0, 1, stacks[i], STACK_SIZE);
+
+    // main is idle priority, so this comes back once all workers exit
+    uint64_t start = cycle_cnt_read();
+    sched_yield();
+    report(name, cycle_cnt_read() - start, NTHREADS);
+}
+
+static void run_smp(const char *name, smp_fn_t fn, unsigned nharts) {
+    counter = 0;
+    atomic64_set(&acount, 0);
+
+    uint64_t start = cycle_cnt_read();
+    for (unsigned h = 1; h < nharts; h++)
+        smp_call_on(h, fn, 0);
+    fn(0);
+    for (unsigned h = 1; h < nharts; h++)
+        smp_wait(h);
+    report(name, cycle_cnt_read() - start, nharts);
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "spinlock-bench\r\n");
+
+    sched_init(QUANTUM_US);
+    sched_start();
+
+    run("spin", spin_worker);
+    run("spin_irqsave", spin_irq_worker);
+    run("ticket_irqsave", ticket_irq_worker);
+    run("rwlock_write", write_worker);
+    run("amoadd", amo_worker);
+
+    unsigned nharts = smp_init(10 * 1000);
+    bench_put(UART0, "harts: ", nharts, "\r\n");
+    if (nharts > 1) {
+        run_smp("smp spin", spin_worker, nharts);
+        run_smp("smp ticket", ticket_worker, nharts);
+        run_smp("smp rwlock_write", write_worker, nharts);
+        run_smp("smp amoadd", amo_worker, nharts);
+    }
+
+    while (1)
+        asm volatile("wfi");
+}
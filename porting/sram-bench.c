@@ -0,0 +1,69 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// trap handler latency with the handler in PSRAM vs WRAM. the same
+// minimal handler (skip the ecall, mret) is assembled into both .text
+// and .hot_text; we point mtvec at each and time ecall round trips,
+// once warm and once right after invalidating the caches, which is
+// what an interrupt arriving after a busy stretch of other code sees.
+
+#define NTRAPS 1000
+
+#define MIN_HANDLER(name, section) \
+    asm(".section " section ", \"ax\"\n" \
+        ".balign 4\n" \
+        ".globl " #name "\n" \
+        #name ":\n" \
+        "  csrr t6, mepc\n" \
+        "  addi t6, t6, 4\n" \
+        "  csrw mepc, t6\n" \
+        "  mret\n" \
+        ".previous\n")
+
+MIN_HANDLER(psram_handler, ".text");
+MIN_HANDLER(sram_handler, ".hot_text");
+
+void psram_handler(void);
+void sram_handler(void);
+
+static uint64_t time_ecall(bool cold) {
+    if (cold) {
+        dcache_flush_all();
+        icache_flush_all();
+    }
+    uint64_t start = cycle_cnt_read();
+    // the handler clobbers t6
+    asm volatile("ecall" : : : "t6", "memory");
+    return cycle_cnt_read() - start;
+}
+
+static void bench(const char *name, void (*handler)(void), bool cold) {
+    uint64_t best = ~0ULL, total = 0;
+
+    csr_write(mtvec, (uint64_t)handler);
+    for (unsigned i = 0; i < NTRAPS; i++) {
+        uint64_t c = time_ecall(cold);
+        total += c;
+        if (c < best)
+            best = c;
+    }
+
+    uart_puts(UART0, name);
+    uart_puts(UART0, cold ? " cold\r\n" : " warm\r\n");
+    bench_put(UART0, "  min cycles: ", best, "\r\n");
+    bench_put(UART0, "  avg cycles: ", total / NTRAPS, "\r\n");
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "sram-bench\r\n");
+
+    irq_disable();
+    bench("psram", psram_handler, false);
+    bench("sram", sram_handler, false);
+    bench("psram", psram_handler, true);
+    bench("sram", sram_handler, true);
+
+    while (1)
+        asm volatile("wfi");
+}
@@ -0,0 +1,112 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// cpu load of lib/sw-serial.c at 9600 and 57600 baud, one channel and
+// NCH channels, every tx busy for the whole window. two numbers:
+//  - spin: how much slower a counting loop gets with the engine on,
+//    which includes trap entry/exit and the cache damage
+//  - handler: cycles spent inside the tick handler itself
+// part of each tick costs the same however many channels there are
+// (trap entry, the port write and read, re-arming the timer), so the
+// cost of one channel is the difference between the NCH and the 1
+// channel runs over NCH - 1, and what is left of the 1 channel run is
+// the fixed cost. jumper TX[i] to RX[i] to have the rx side do real
+// work as well.
+
+#define NCH      4
+#define OS       3 // samples closer to mid-bit than 4, see sw-serial.h
+// in cycles, and only ever compared with cycles, so the nominal clock
+// is good enough: about 10ms, less than 64 bytes at 57600
+#define WINDOW   (CYCLES_PER_SECOND / 100)
+
+static const unsigned tx_pins[NCH] = { 20, 21, 22, 23 };
+static const unsigned rx_pins[NCH] = { 24, 25, 26, 27 };
+
+static uint8_t junk[SW_SERIAL_BUF];
+
+struct load {
+    int64_t spin_pm;     // per mille of the window
+    int64_t handler_pm;
+    int64_t tick_cycles; // handler cycles per tick
+};
+
+static uint64_t spin(void) {
+    uint64_t n = 0;
+    uint64_t end = cycle_cnt_read() + WINDOW;
+    while ((int64_t)(cycle_cnt_read() - end) < 0)
+        n++;
+    return n;
+}
+
+static struct load run(unsigned baud, unsigned nch, uint64_t idle) {
+    sw_serial_init(baud, OS);
+    for (unsigned i = 0; i < nch; i++)
+        sw_serial_add(tx_pins[i], rx_pins[i]);
+    for (unsigned i = 0; i < nch; i++)
+        sw_serial_write(i, junk, sizeof(junk));
+
+    sw_serial_start();
+    sw_serial_reset_stats();
+    uint64_t n = spin();
+    struct sw_serial_stats st;
+    sw_serial_stats(&st);
+    sw_serial_stop();
+
+    struct load l = {
+        .spin_pm = n < idle ? (idle - n) * 1000 / idle : 0,
+        .handler_pm = st.busy_cycles * 1000 / WINDOW,
+        .tick_cycles = st.ticks ? st.busy_cycles / st.ticks : 0,
+    };
+
+    uart_putdec(UART0, baud);
+    uart_puts(UART0, " baud, ");
+    uart_putdec(UART0, nch);
+    uart_puts(UART0, " ch:");
+    bench_put_tenths(UART0, " spin ", l.spin_pm, "%");
+    bench_put_tenths(UART0, " handler ", l.handler_pm, "%");
+    bench_put(UART0, " ", l.tick_cycles, " cycles/tick,");
+    bench_put(UART0, " max tick ", st.max_cycles, " cycles, rx ");
+    unsigned got = 0;
+    for (unsigned i = 0; i < nch; i++)
+        got += sw_serial_rx_count(i);
+    bench_put(UART0, "", got, " bytes\r\n");
+    return l;
+}
+
+static void measure(unsigned baud, uint64_t idle) {
+    struct load one = run(baud, 1, idle);
+    struct load all = run(baud, NCH, idle);
+
+    struct load ch = {
+        .spin_pm = (all.spin_pm - one.spin_pm) / (NCH - 1),
+        .handler_pm = (all.handler_pm - one.handler_pm) / (NCH - 1),
+        .tick_cycles = (all.tick_cycles - one.tick_cycles) / (NCH - 1),
+    };
+    bench_put_tenths(UART0, "  per channel: spin ", ch.spin_pm, "%");
+    bench_put_tenths(UART0, " handler ", ch.handler_pm, "%");
+    bench_put(UART0, " ", ch.tick_cycles, " cycles/tick\r\n");
+    bench_put_tenths(UART0, "  fixed:       spin ",
+                     one.spin_pm - ch.spin_pm, "%");
+    bench_put_tenths(UART0, " handler ", one.handler_pm - ch.handler_pm, "%");
+    bench_put(UART0, " ", one.tick_cycles - ch.tick_cycles,
+              " cycles/tick\r\n");
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "sw-serial-bench\r\n");
+
+    for (unsigned i = 0; i < sizeof(junk); i++)
+        junk[i] = 0x55 ^ i;
+
+    trap_init();
+    irq_enable();
+
+    uint64_t idle = spin();
+
+    measure(9600, idle);
+    measure(57600, idle);
+
+    while (1)
+        asm volatile("wfi");
+}
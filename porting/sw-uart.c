@@ -1,105 +1,104 @@
 #define LOG_LEVEL 3
 #include "lib.h"
 
-static volatile uint32_t *const gpio_cfg0 = (volatile uint32_t *)0x200008c4;
-
-// Helper function to convert an integer to a hexadecimal string and print using putc
-void itoa_hex(uint64_t num) {
-    static const char hex_digits[] = "0123456789ABCDEF";
-
-    // Print the '0x' prefix
-    uart_putc(UART0, '0');
-    uart_putc(UART0, 'x');
-
-    // Print each hexadecimal digit
-    for (int i = 60; i >= 0; i -= 4) {
-        uart_putc(UART0, hex_digits[(num >> i) & 0xF]);
+// software uart on TX/RX at 115200, checked two ways:
+//  - the tx pin is also captured (lib/capture.h), and every edge of a
+//    run of 'U's (an edge on every bit boundary) is compared against
+//    where the bit clock puts it
+//  - with a jumper from TX to RX, a string has to come back intact
+
+enum { TX = 16, RX = 28 };
+
+#define BAUD     115200
+#define NTIMING  32
+#define NEDGES   512
+
+static uint8_t rx_buf[256];
+static capture_edge_t edges[NEDGES];
+static struct sw_uart su;
+
+static void check_timing(void) {
+    uint8_t pattern[NTIMING];
+    memset(pattern, 'U', sizeof(pattern));
+
+    capture_init(edges, NEDGES);
+    capture_start(1ULL << TX);
+    sw_uart_write(&su, pattern, sizeof(pattern));
+    capture_stop();
+
+    // 'U' is 0x55: with start and stop bits the line flips at every
+    // bit boundary, so edge i belongs i bit times after the first one
+    capture_edge_t e;
+    uint64_t t0 = 0, worst = 0;
+    unsigned n = 0;
+    while (capture_get(&e)) {
+        uint64_t t = CAPTURE_CYCLES(e);
+        if (n == 0)
+            t0 = t;
+        uint64_t ideal = t0 + (uint64_t)n * su.hz / BAUD;
+        uint64_t err = t > ideal ? t - ideal : ideal - t;
+        worst = err > worst ? err : worst;
+        n++;
     }
-}
-
-#define UART_CLOCK  40000000UL
-#define BAUD        9600
-#define BAUD_TO_CYCLES(baud) ((UART_CLOCK)/baud)
-
-#define VAL_N_US(us)   (((us) * FREQ) / 1000000)
 
-#define ON(pin)  do { \
-    uint32_t val = get32(gpio_cfg0 + (pin)); \
-    val |= (1 << 25); \
-    put32(gpio_cfg0 + (pin), val); \
-} while (0)
-
-typedef struct {
-    unsigned rx;
-    unsigned tx;
-    unsigned cyc_per_bit;
-} sw_uart_t;
-
-static void sw_uart_init(sw_uart_t *s, unsigned rx, unsigned tx) {
-    // default baud rate is 115200
-    s->rx = rx;
-    s->tx = tx;
-    s->cyc_per_bit = BAUD_TO_CYCLES(BAUD);
-
-    gpio_set_input(rx);
-    gpio_set_output(tx);
+    bench_put(UART0, "edges: ", n, "");
+    bench_put(UART0, " of ", NTIMING * 10, "\r\n");
+    bench_put(UART0, "worst edge error: ", worst * 1000000000 / su.hz, " ns, ");
+    bench_put(UART0, "",
+              worst * 1000 / su.bit_cycles, " per mille of a bit\r\n");
+    // a receiver sampling mid-bit has ~50% of a bit to play with,
+    // keep well clear of that
+    uart_puts(UART0, n == NTIMING * 10 && worst * 20 < su.bit_cycles
+                         ? "timing: PASS\r\n" : "timing: FAIL\r\n");
 }
 
-static inline void gpio_write_on_raw(unsigned pin) {
-    uint32_t val = get32(gpio_cfg0 + (pin));
-    val |= (1 << 25);
-    put32(gpio_cfg0 + (pin), val);
+static bool same(const char *a, const char *b, unsigned n) {
+    for (unsigned i = 0; i < n; i++)
+        if (a[i] != b[i])
+            return false;
+    return true;
 }
 
-static inline void gpio_write_off_raw(unsigned pin) {
-    uint32_t val = get32(gpio_cfg0 + (pin));
-    val |= (1 << 26);
-    put32(gpio_cfg0 + (pin), val);
-}
+static void check_loopback(void) {
+    static const char msg[] = "the quick brown fox jumps over the lazy dog";
+    char back[sizeof(msg)];
 
-static inline void wait_for(unsigned s, unsigned delay) {
-    while (cycle_cnt_read() - s <= delay)
+    while (sw_uart_try_getc(&su) >= 0)
         ;
+    sw_uart_puts(&su, msg);
+    delay_us(200); // let the last edge interrupts land
+
+    unsigned n = 0;
+    int c;
+    while (n < sizeof(msg) - 1 && (c = sw_uart_try_getc(&su)) >= 0)
+        back[n++] = c;
+    back[n] = 0;
+
+    if (n == 0)
+        uart_puts(UART0, "loopback: nothing back, is TX jumpered to RX?\r\n");
+    else if (n == sizeof(msg) - 1 && same(back, msg, n))
+        uart_puts(UART0, "loopback: PASS\r\n");
+    else
+        uart_puts(UART0, "loopback: FAIL\r\n");
+    bench_put(UART0, "framing errors: ", su.rx_framing, "\r\n");
 }
 
-void sw_uart_put8(sw_uart_t *s, uint8_t b) {
-    unsigned start;
-    unsigned bit_width = s->cyc_per_bit;
-    start = cycle_cnt_read();
-
-    gpio_write_off_raw(s->tx);
-    wait_for(start, bit_width);
-
-    for (unsigned i = 0; i < 8; i++) {
-        if (b & (1 << i))
-            gpio_write_on_raw(s->tx);
-        else
-            gpio_write_off_raw(s->tx);
-
-    
-        wait_for(start, (i+2)*bit_width);
-    }
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "sw-uart\r\n");
 
-    gpio_write_on_raw(s->tx);
-    wait_for(start, 10*bit_width);
-}
+    bench_put(UART0, "cpu hz: ", cycle_cnt_calibrate(UART0, 115200), "\r\n");
 
-enum { tx=16, rx=28 };
+    trap_init();
+    plic_init();
+    irq_enable();
 
-void kmain(void) {
-    sw_uart_t s;
-    sw_uart_init(&s, rx, tx);
+    sw_uart_init(&su, TX, RX, BAUD, rx_buf, sizeof(rx_buf));
+    bench_put(UART0, "cycles per bit: ", su.bit_cycles, "\r\n");
 
-    uart_init(UART0, 115200);
+    check_timing();
+    check_loopback();
 
-    unsigned s1 = cycle_cnt_read();
-        gpio_write_on_raw(tx);
-    unsigned s2 = cycle_cnt_read();
-    
-    while (1) {
-        itoa_hex(s2-s1); uart_puts(UART0, "\r\n");
-        itoa_hex(s.cyc_per_bit); uart_puts(UART0, "\r\n");
-        delay_ms(1000);
-    }
+    while (1)
+        asm volatile("wfi");
 }
-
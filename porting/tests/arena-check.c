@@ -0,0 +1,260 @@
+// host test of lib/arena.c, built with ARENA_DEBUG: nested scopes give
+// back exactly what was allocated inside them and poison it, arena_reset
+// drops everything, an out-of-order scope end is caught, and sizes that
+// don't fit (or would wrap when rounded) are refused. also times
+// arena_alloc against kmalloc/kfree on the same sizes.
+//
+//   make check   or   ./tests/arena-check
+
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "arena.h"
+#include "kmalloc.h"
+#include "uart.h"
+
+#define HEAP_SIZE 0x400000
+#define NALLOCS   4096
+
+#define STR(x)  STR_(x)
+#define STR_(x) #x
+
+// what memmap.ld provides on the board
+asm(".bss\n"
+    ".balign 4096\n"
+    ".globl __heap_start__\n"
+    "__heap_start__:\n"
+    ".skip " STR(HEAP_SIZE) "\n"
+    ".globl __heap_end__\n"
+    "__heap_end__:\n"
+    ".previous\n");
+
+static int failed;
+
+#define CHECK(cond)                                              \
+  do {                                                           \
+    if (!(cond)) {                                               \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+      failed = 1;                                                \
+    }                                                            \
+  } while (0)
+
+// arena_scope_end reports to UART0 and then hangs; jump back out of the
+// report instead
+volatile struct uart *const UART0 = 0;
+static jmp_buf caught;
+static bool expect_report;
+
+void uart_puts(volatile struct uart *uart, const char *s) {
+  (void)uart;
+  if (!expect_report) {
+    printf("FAIL unexpected report: %s", s);
+    failed = 1;
+  }
+  longjmp(caught, 1);
+}
+
+static bool poisoned(const void *p, size_t n) {
+  const u8 *b = p;
+  for (size_t i = 0; i < n; i++)
+    if (b[i] != ARENA_POISON)
+      return false;
+  return true;
+}
+
+static bool filled(const void *p, size_t n, u8 v) {
+  const u8 *b = p;
+  for (size_t i = 0; i < n; i++)
+    if (b[i] != v)
+      return false;
+  return true;
+}
+
+static void check_init(void) {
+  static char buf[256] __attribute__((aligned(8)));
+  struct arena a;
+
+  // an odd start is rounded up and the end stays aligned
+  arena_init(&a, buf + 3, 100);
+  CHECK(a.base == buf + 8);
+  CHECK(((uintptr_t)a.end & (ARENA_ALIGN - 1)) == 0);
+  CHECK(a.end <= buf + 103);
+
+  // less room than the alignment pad leaves an empty arena, not a huge one
+  arena_init(&a, buf + 1, 5);
+  CHECK(a.end == a.base);
+  CHECK(arena_alloc(&a, 1) == 0);
+  CHECK(arena_alloc(&a, 0) == a.base);
+}
+
+static void check_alloc(void) {
+  static char buf[128] __attribute__((aligned(8)));
+  struct arena a;
+
+  arena_init(&a, buf, sizeof(buf));
+  char *p = arena_alloc(&a, 1), *q = arena_alloc(&a, 9);
+  CHECK(p == buf && q == buf + 8);
+  CHECK(arena_used(&a) == 24);
+
+  // sizes that would wrap to 0 when rounded up
+  CHECK(arena_alloc(&a, SIZE_MAX) == 0);
+  CHECK(arena_alloc(&a, SIZE_MAX - 3) == 0);
+  CHECK(arena_alloc(&a, SIZE_MAX - ARENA_ALIGN + 1) == 0);
+  CHECK(arena_used(&a) == 24);
+
+  // exactly full, then nothing more
+  CHECK(arena_alloc(&a, sizeof(buf) - 24) == buf + 24);
+  CHECK(arena_alloc(&a, 1) == 0);
+  CHECK(arena_used(&a) == sizeof(buf));
+}
+
+static void check_scopes(void) {
+  static char buf[1024] __attribute__((aligned(8)));
+  struct arena a;
+
+  arena_init(&a, buf, sizeof(buf));
+  char *keep = arena_alloc(&a, 40);
+  memset(keep, 0x11, 40);
+
+  struct arena_scope outer = arena_scope_begin(&a);
+  char *o = arena_alloc(&a, 100);
+  memset(o, 0x22, 100);
+
+  struct arena_scope inner = arena_scope_begin(&a);
+  CHECK(a.depth == 2);
+  char *i1 = arena_alloc(&a, 200), *i2 = arena_alloc(&a, 13);
+  memset(i1, 0x33, 200);
+  memset(i2, 0x33, 13);
+  arena_scope_end(&a, inner);
+
+  // the inner allocations are gone and poisoned, the rest untouched
+  CHECK(a.depth == 1);
+  CHECK(a.ptr == i1);
+  CHECK(poisoned(i1, i2 + 16 - i1));
+  CHECK(filled(o, 100, 0x22));
+  CHECK(arena_alloc(&a, 8) == i1);
+
+  arena_scope_end(&a, outer);
+  CHECK(a.depth == 0);
+  CHECK(a.ptr == o);
+  CHECK(filled(keep, 40, 0x11));
+  CHECK(poisoned(o, i1 + 8 - o));
+
+  // closing outer while inner is open is caught
+  outer = arena_scope_begin(&a);
+  arena_alloc(&a, 16);
+  inner = arena_scope_begin(&a);
+  expect_report = true;
+  if (!setjmp(caught)) {
+    arena_scope_end(&a, outer);
+    CHECK(!"out of order scope end not caught");
+  }
+  expect_report = false;
+  arena_scope_end(&a, inner);
+  arena_scope_end(&a, outer);
+  CHECK(a.depth == 0 && a.ptr == o);
+}
+
+static void check_reset(void) {
+  static char buf[512] __attribute__((aligned(8)));
+  struct arena a;
+
+  arena_init(&a, buf, sizeof(buf));
+  arena_scope_begin(&a);
+  char *p = arena_alloc(&a, 300);
+  memset(p, 0x44, 300);
+  arena_scope_begin(&a);
+  arena_alloc(&a, 100);
+
+  arena_reset(&a);
+  CHECK(a.depth == 0);
+  CHECK(arena_used(&a) == 0);
+  CHECK(poisoned(buf, 400));
+  CHECK(arena_alloc(&a, 1) == buf);
+}
+
+static void check_create(void) {
+  struct kmalloc_stats st;
+
+  kmalloc_init();
+  struct arena *a = arena_create(64 * 1024);
+  CHECK(a != 0);
+  if (!a)
+    return;
+  CHECK((char *)a->base >= (char *)(a + 1));
+  CHECK(a->end - a->base >= 64 * 1024);
+
+  // the whole arena is usable and ends at its last page
+  size_t n = 0;
+  while (arena_alloc(a, 1000))
+    n++;
+  CHECK(n == (size_t)(a->end - a->base) / 1000);
+  CHECK(a->end <= (char *)a + a->npages * PAGE_SIZE);
+
+  arena_destroy(a);
+  kmalloc_get_stats(&st);
+  CHECK(st.pages_used == 0);
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// NALLOCS small objects and then all of them dropped, many rounds
+static void bench(void) {
+  static void *objs[NALLOCS];
+  static u32 sizes[NALLOCS];
+  enum { ROUNDS = 256 };
+  u32 seed = 12345;
+
+  for (unsigned i = 0; i < NALLOCS; i++) {
+    seed = seed * 1664525 + 1013904223;
+    sizes[i] = 8 + (seed >> 8) % 248;
+  }
+
+  kmalloc_init();
+  struct arena *a = arena_create(NALLOCS * 256);
+  double t = now();
+  for (unsigned r = 0; r < ROUNDS; r++) {
+    struct arena_scope s = arena_scope_begin(a);
+    for (unsigned i = 0; i < NALLOCS; i++)
+      objs[i] = arena_alloc(a, sizes[i]);
+    // the last object of the round, so the loop isn't thrown away
+    CHECK(objs[NALLOCS - 1] != 0);
+    arena_scope_end(a, s);
+  }
+  double ta = now() - t;
+  arena_destroy(a);
+
+  t = now();
+  for (unsigned r = 0; r < ROUNDS; r++) {
+    for (unsigned i = 0; i < NALLOCS; i++)
+      objs[i] = kmalloc(sizes[i]);
+    for (unsigned i = 0; i < NALLOCS; i++)
+      kfree(objs[i]);
+  }
+  double tk = now() - t;
+
+  // scope ends poison in this build, so the arena side pays a memset
+  // per round that a normal build doesn't
+  printf("%u x %u allocs: arena %.1f ns/alloc, kmalloc+kfree %.1f ns\n",
+         ROUNDS, NALLOCS, ta * 1e9 / (ROUNDS * NALLOCS),
+         tk * 1e9 / (ROUNDS * NALLOCS));
+}
+
+int main(void) {
+  check_init();
+  check_alloc();
+  check_scopes();
+  check_reset();
+  check_create();
+  bench();
+
+  puts(failed ? "arena-check: FAIL" : "arena-check: ok");
+  return failed;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "types.h"
+
+// host stand-in for lib/csr.h: one hart, no interrupts to mask
+
+static inline unsigned hart_id(void) {
+  return 0;
+}
+
+static inline u64 irq_save(void) {
+  return 0;
+}
+
+static inline void irq_restore(u64 flags) {
+  (void)flags;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "csr.h"
+#include "types.h"
+
+// host stand-in for lib/spinlock.h: the host tests are single threaded
+
+typedef struct {
+  volatile u32 locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+static inline u64 spin_lock_irqsave(spinlock_t *l) {
+  l->locked = 1;
+  return irq_save();
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *l, u64 flags) {
+  l->locked = 0;
+  irq_restore(flags);
+}
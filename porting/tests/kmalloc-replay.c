@@ -0,0 +1,249 @@
+// host replay of allocation traces through lib/kmalloc.c, timed
+// against glibc malloc on the same trace. also checks that live
+// objects never overlap, that freed page runs merge back together and
+// that kfree refuses pointers it never handed out.
+//
+//   make check   or   ./tests/kmalloc-replay [steps]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "kmalloc.h"
+
+#define HEAP_SIZE 0x4000000
+#define NSLOTS    1024
+
+#define STR(x)  STR_(x)
+#define STR_(x) #x
+
+// what memmap.ld provides on the board
+asm(".bss\n"
+    ".balign 4096\n"
+    ".globl __heap_start__\n"
+    "__heap_start__:\n"
+    ".skip " STR(HEAP_SIZE) "\n"
+    ".globl __heap_end__\n"
+    "__heap_end__:\n"
+    ".previous\n");
+
+struct op {
+  u32 slot;
+  u32 size;
+};
+
+static struct op *trace;
+static unsigned nsteps;
+static int failed;
+
+#define CHECK(cond)                                              \
+  do {                                                           \
+    if (!(cond)) {                                               \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);     \
+      failed = 1;                                                \
+    }                                                            \
+  } while (0)
+
+static u32 seed = 12345;
+
+static u32 rand32(void) {
+  seed = seed * 1664525 + 1013904223;
+  return seed;
+}
+
+// same mix as kmalloc-bench.c: mostly small, the odd multi-page buffer
+static u32 rand_size(void) {
+  u32 r = rand32();
+  switch (r >> 28) {
+  case 0:
+    return 2048 + (r >> 8) % 8192;
+  case 1: case 2: case 3:
+    return 256 + (r >> 8) % 1792;
+  default:
+    return 8 + (r >> 8) % 248;
+  }
+}
+
+// a trace where the live set swells and shrinks, so large runs are
+// freed in random order and have to merge again
+static void make_trace(void) {
+  trace = malloc(nsteps * sizeof(*trace));
+  for (unsigned i = 0; i < nsteps; i++) {
+    unsigned phase = (i / (nsteps / 8)) & 1;
+    trace[i].slot = rand32() % NSLOTS;
+    // on the shrinking phases most steps only free
+    trace[i].size = (phase && rand32() % 4) ? 0 : rand_size();
+  }
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double replay(void *(*alloc)(size_t), void (*release)(void *)) {
+  static void *slots[NSLOTS];
+  u64 fails = 0;
+
+  double t = now();
+  for (unsigned i = 0; i < nsteps; i++) {
+    struct op o = trace[i];
+    release(slots[o.slot]);
+    slots[o.slot] = o.size ? alloc(o.size) : 0;
+    fails += o.size && !slots[o.slot];
+  }
+  t = now() - t;
+
+  for (unsigned s = 0; s < NSLOTS; s++) {
+    release(slots[s]);
+    slots[s] = 0;
+  }
+  CHECK(fails == 0);
+  return t;
+}
+
+// the checked replay stamps every object with its slot and step so an
+// overlap shows up as a clobbered stamp at free time
+static void *live[NSLOTS];
+static u32 live_size[NSLOTS];
+
+static void stamp(unsigned s, u32 step) {
+  u8 *p = live[s];
+  u32 n = live_size[s];
+  p[0] = s;
+  p[n / 2] = step;
+  p[n - 1] = s ^ step;
+}
+
+static bool stamp_ok(unsigned s, u32 step) {
+  u8 *p = live[s];
+  u32 n = live_size[s];
+  return p[0] == (u8)s && p[n / 2] == (u8)step && p[n - 1] == (u8)(s ^ step);
+}
+
+static void check_trace(void) {
+  static u32 born[NSLOTS];
+  struct kmalloc_stats st;
+
+  kmalloc_init();
+  for (unsigned i = 0; i < nsteps; i++) {
+    struct op o = trace[i];
+    if (live[o.slot]) {
+      CHECK(stamp_ok(o.slot, born[o.slot]));
+      kfree(live[o.slot]);
+      live[o.slot] = 0;
+    }
+    if (o.size) {
+      live[o.slot] = kmalloc(o.size);
+      live_size[o.slot] = o.size;
+      born[o.slot] = i;
+      CHECK(live[o.slot] != 0);
+      if (live[o.slot])
+        stamp(o.slot, i);
+    }
+  }
+  for (unsigned s = 0; s < NSLOTS; s++) {
+    if (live[s])
+      CHECK(stamp_ok(s, born[s]));
+    kfree(live[s]);
+    live[s] = 0;
+  }
+
+  // only slab pages (which keep their class) may still be in use, and
+  // every other page is in a run or back above heap_brk
+  kmalloc_get_stats(&st);
+  u64 slab = 0;
+  for (unsigned c = 0; c < KMALLOC_NCLASSES; c++)
+    slab += st.class_pages[c];
+  CHECK(st.large_pages == 0);
+  CHECK(st.pages_used == slab);
+  CHECK(st.pages_used + st.free_pages + st.fresh_pages == st.heap_pages);
+  CHECK(st.bad_frees == 0);
+  printf("trace: %lu pages hwm, %lu slab pages, %lu free runs "
+         "(%lu pages, largest %lu)\n",
+         st.pages_hwm, slab, st.free_runs, st.free_pages, st.largest_run);
+}
+
+// large runs freed in shuffled order must all merge back into heap_brk
+static void check_coalesce(void) {
+  enum { N = 64 };
+  void *p[N];
+  unsigned order[N];
+  struct kmalloc_stats st;
+
+  kmalloc_init();
+  for (unsigned i = 0; i < N; i++) {
+    p[i] = kpage_alloc(1 + i % 5);
+    order[i] = i;
+  }
+  for (unsigned i = N - 1; i > 0; i--) {
+    unsigned j = rand32() % (i + 1), t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+  for (unsigned i = 0; i < N; i++)
+    kfree(p[order[i]]);
+  kmalloc_get_stats(&st);
+  CHECK(st.pages_used == 0);
+  CHECK(st.free_runs == 0);
+  CHECK(st.fresh_pages == st.heap_pages);
+
+  // a hole between two live runs is reused whole
+  void *a = kpage_alloc(3), *b = kpage_alloc(4), *c = kpage_alloc(3);
+  kfree(b);
+  kfree(a);
+  kmalloc_get_stats(&st);
+  CHECK(st.free_runs == 1 && st.largest_run == 7);
+  CHECK(kpage_alloc(7) == a);
+  (void)c;
+}
+
+static void check_bad_free(void) {
+  struct kmalloc_stats st;
+  static char outside[64];
+
+  kmalloc_init();
+  char *small = kmalloc(100);    // class 128
+  char *large = kmalloc(3 * PAGE_SIZE);
+  char *spare = kpage_alloc(2);
+  char *guard = kpage_alloc(1);  // keeps spare below heap_brk
+  kfree(spare);                  // spare is now a free run
+
+  kfree(outside);                // not the heap
+  kfree(spare);                  // a free page
+  kfree(spare + PAGE_SIZE);      // inside a free run
+  kfree(small + 8);              // not on an object boundary
+  kfree(large + 64);             // inside a large allocation
+  kfree(large + PAGE_SIZE);      // a later page of it
+  kfree((char *)__builtin_frame_address(0));
+
+  kmalloc_get_stats(&st);
+  CHECK(st.bad_frees == 7);
+  CHECK(st.nfree == 1); // only spare
+
+  // the heap is still intact
+  kfree(small);
+  kfree(large);
+  kfree(guard);
+  CHECK(kmalloc(100) == small);
+  CHECK(kmalloc(3 * PAGE_SIZE) != 0);
+}
+
+int main(int argc, char **argv) {
+  nsteps = argc > 1 ? strtoul(argv[1], 0, 0) : 1 << 20;
+  make_trace();
+
+  check_trace();
+  check_coalesce();
+  check_bad_free();
+
+  kmalloc_init();
+  double tk = replay(kmalloc, kfree);
+  double tg = replay(malloc, free);
+  printf("%u steps: kmalloc %.1f ns/step, glibc %.1f ns/step (%.2fx)\n",
+         nsteps, tk * 1e9 / nsteps, tg * 1e9 / nsteps, tg / tk);
+
+  puts(failed ? "kmalloc-replay: FAIL" : "kmalloc-replay: ok");
+  return failed;
+}
@@ -0,0 +1,164 @@
+// host side of tests/lz4-roundtrip.py: runs lib/lz4.c natively over
+// the blocks in a file and checks every way the bootloader can use it.
+//
+// the file is a list of records, all little endian:
+//   u32 compressed len | u32 raw len | compressed block | raw block
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lz4.h"
+
+#define CANARY 0xa5
+
+static int failed;
+static unsigned nblocks;
+
+#define CHECK(cond, what)                                                \
+  do {                                                                   \
+    if (!(cond)) {                                                       \
+      printf("FAIL block %u: %s (%s:%d)\n", nblocks, what, __FILE__,     \
+             __LINE__);                                                  \
+      failed = 1;                                                        \
+    }                                                                    \
+  } while (0)
+
+// largest output seen between two polls, or since the last one when a
+// feed call returns
+static u64 poll_gap;
+static u64 polls;
+static u8 *last_out;
+
+static void track(void *ctx) {
+  struct lz4_stream *s = ctx;
+  u64 gap = s->out - last_out;
+  if (gap > poll_gap)
+    poll_gap = gap;
+  last_out = s->out;
+  polls++;
+}
+
+// decode in slice-sized feeds into a buffer of cap bytes followed by
+// canaries; returns lz4_stream_finish or -1 if a feed failed
+static i64 sliced(const u8 *src, u32 clen, u8 *dst, u64 cap, u32 slice) {
+  struct lz4_stream s;
+
+  lz4_stream_init(&s, dst, cap);
+  lz4_stream_set_poll(&s, track, &s);
+  last_out = dst;
+  for (u32 off = 0; off < clen; off += slice) {
+    u32 n = clen - off < slice ? clen - off : slice;
+    if (!lz4_stream_feed(&s, src + off, n))
+      return -1;
+    // what a feed leaves unpolled also counts
+    u64 gap = s.out - last_out;
+    if (gap > poll_gap)
+      poll_gap = gap;
+    last_out = s.out;
+  }
+  return lz4_stream_finish(&s);
+}
+
+struct reader {
+  const u8 *p;
+};
+
+static void read_cb(void *ctx, void *dst, u32 n) {
+  struct reader *r = ctx;
+  memcpy(dst, r->p, n);
+  r->p += n;
+}
+
+static bool canaries_ok(const u8 *p, u32 n) {
+  for (u32 i = 0; i < n; i++)
+    if (p[i] != CANARY)
+      return false;
+  return true;
+}
+
+static void check_block(const u8 *comp, u32 clen, const u8 *raw, u32 rlen) {
+  static const u32 slices[] = { 1, 7, 333, 4096 };
+  u8 *out = malloc(rlen + 64);
+
+  // memory to memory
+  memset(out, CANARY, rlen + 64);
+  CHECK(lz4_decompress(comp, clen, out, rlen) == rlen, "lz4_decompress");
+  CHECK(!memcmp(out, raw, rlen), "lz4_decompress output");
+  CHECK(canaries_ok(out + rlen, 64), "lz4_decompress wrote past cap");
+
+  // fed in 1 byte, odd and 4K pieces, with the poll hook watching how
+  // much comes out between polls
+  for (unsigned i = 0; i < sizeof(slices) / sizeof(slices[0]); i++) {
+    memset(out, CANARY, rlen + 64);
+    poll_gap = 0;
+    CHECK(sliced(comp, clen, out, rlen, slices[i]) == rlen, "sliced feed");
+    CHECK(!memcmp(out, raw, rlen), "sliced feed output");
+    CHECK(canaries_ok(out + rlen, 64), "sliced feed wrote past cap");
+    CHECK(poll_gap < 2 * LZ4_POLL_BYTES, "too much output between polls");
+  }
+
+  // through a read callback like uart_ring_read
+  struct reader r = { comp };
+  memset(out, CANARY, rlen);
+  CHECK(lz4_decompress_stream(read_cb, &r, clen, out, rlen) == rlen,
+        "lz4_decompress_stream");
+  CHECK(!memcmp(out, raw, rlen), "lz4_decompress_stream output");
+
+  // one byte short of room must fail without writing past the end
+  for (unsigned i = 0; i < 2; i++) {
+    memset(out, CANARY, rlen + 64);
+    i64 got = i ? sliced(comp, clen, out, rlen - 1, 7)
+                : lz4_decompress(comp, clen, out, rlen - 1);
+    CHECK(got == -1, "undersized output accepted");
+    CHECK(canaries_ok(out + rlen - 1, 64), "undersized output overrun");
+  }
+
+  // input cut short must not pass as complete
+  if (clen > 1)
+    CHECK(lz4_decompress(comp, clen - 1, out, rlen) != rlen,
+          "truncated block accepted");
+
+  // in place: compressed block at the very end of the buffer
+  u64 margin = LZ4_INPLACE_MARGIN(clen);
+  u64 size = (rlen > clen ? rlen : clen) + margin;
+  u8 *buf = malloc(size);
+  memcpy(buf + size - clen, comp, clen);
+  CHECK(lz4_decompress(buf + size - clen, clen, buf, size) == rlen,
+        "in place");
+  CHECK(!memcmp(buf, raw, rlen), "in place output");
+
+  free(buf);
+  free(out);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s blocks\n", argv[0]);
+    return 2;
+  }
+  FILE *f = fopen(argv[1], "rb");
+  if (!f) {
+    perror(argv[1]);
+    return 2;
+  }
+
+  u32 len[2];
+  while (fread(len, sizeof(len), 1, f) == 1) {
+    u8 *comp = malloc(len[0]), *raw = malloc(len[1]);
+    if (fread(comp, 1, len[0], f) != len[0] ||
+        fread(raw, 1, len[1], f) != len[1])
+    {
+      fprintf(stderr, "%s: short record\n", argv[1]);
+      return 2;
+    }
+    check_block(comp, len[0], raw, len[1]);
+    nblocks++;
+    free(comp);
+    free(raw);
+  }
+  fclose(f);
+
+  printf("%u blocks, %lu polls: %s\n", nblocks, polls, failed ? "FAIL" : "ok");
+  return failed;
+}
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Round-trip images through the reference compressors and lib/lz4.c.
+
+    tests/lz4-roundtrip.py tests/lz4-check [files...]
+
+Every input is compressed with the lz4 tool at several levels and block
+sizes (skipped if it isn't installed) and with tools/lz4pack.py. The
+blocks of each frame go to tests/lz4-check, which decodes them with
+lib/lz4.c in every way the bootloader can use it. Stored (incompressible)
+blocks are sent raw by uart-load.py and are skipped here.
+"""
+
+import os
+import random
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "tools"))
+
+import lz4pack  # noqa: E402
+
+# level and block size (-B4 64K .. -B7 4M) for the lz4 tool
+LZ4_ARGS = [["-1", "-B4"], ["-9", "-B5"], ["-12", "-B7"], ["--fast=8", "-B6"]]
+
+
+def samples():
+    rng = random.Random(36)
+    yield "zeros", bytes(300 * 1024)
+    yield "one-byte", b"\x7f"
+    text = b"the quick brown fox jumps over the lazy dog. " * 40
+    yield "text", bytes(rng.choice(text) for _ in range(20000)) + text * 50
+    mixed = bytearray()
+    while len(mixed) < 200 * 1024:
+        n = rng.randrange(16, 4096)
+        mixed += bytes(n) if rng.random() < 0.3 else \
+            bytes(rng.randrange(16) for _ in range(n))
+    yield "mixed", bytes(mixed)
+    # long runs right at the end, and matches over the 64K offset limit
+    yield "tail-run", bytes(rng.randrange(256) for _ in range(70000)) + \
+        b"\x55" * 100000
+
+
+def frames(data, tmp):
+    yield "lz4pack", lz4pack.write_frame(data)
+    if not shutil.which("lz4"):
+        return
+    src = os.path.join(tmp, "in")
+    open(src, "wb").write(data)
+    for args in LZ4_ARGS:
+        out = subprocess.run(["lz4", "-q", "-c"] + args + [src],
+                             check=True, stdout=subprocess.PIPE).stdout
+        yield "lz4 " + " ".join(args), out
+
+
+def records(name, data, tmp):
+    out = bytearray()
+    for how, frame in frames(data, tmp):
+        pos = 0
+        for compressed, blk in lz4pack.read_frame(frame):
+            raw = data[pos:pos + len(lz4pack.decompress_block(blk))] \
+                if compressed else data[pos:pos + len(blk)]
+            pos += len(raw)
+            if compressed:
+                out += struct.pack("<II", len(blk), len(raw)) + blk + raw
+        if pos != len(data):
+            sys.exit("%s/%s: frame doesn't cover the input" % (name, how))
+    return out
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__.split("\n")[2].strip())
+    check = sys.argv[1]
+    inputs = list(samples())
+    for path in sys.argv[2:]:
+        inputs.append((os.path.basename(path), open(path, "rb").read()))
+    if not shutil.which("lz4"):
+        print("lz4-roundtrip: no lz4 tool, lz4pack.py frames only")
+
+    ok = True
+    with tempfile.TemporaryDirectory() as tmp:
+        blocks = os.path.join(tmp, "blocks")
+        for name, data in inputs:
+            open(blocks, "wb").write(records(name, data, tmp))
+            r = subprocess.run([check, blocks], stdout=subprocess.PIPE,
+                               universal_newlines=True)
+            print("%-10s %7d bytes: %s" % (name, len(data), r.stdout.strip()))
+            ok &= r.returncode == 0
+    print("lz4-roundtrip: %s" % ("ok" if ok else "FAIL"))
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
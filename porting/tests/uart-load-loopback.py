@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+"""Run tools/uart-load.py against a model of boot.c over a pty.
+
+    tests/uart-load-loopback.py [--seed N]
+
+No board or pyserial needed. The host side is the real hello()/send()
+from uart-load.py on the pty slave; the target side is a Python copy of
+the boot.c receive loop on the master. A fault injector between them
+drops, corrupts and truncates host frames and loses target replies, so
+the NAK/resync and timeout paths of the go-back-n sender get exercised.
+Both a plain image and an LZ4 frame are sent; the test checks the
+target memory against the image and that it jumped to the entry point.
+One run also loses the JUMP ack, which the target can't repeat: the
+sender has to finish without an error and report the jump unconfirmed.
+"""
+
+import argparse
+import importlib.util
+import os
+import pty
+import queue
+import random
+import select
+import struct
+import sys
+import termios
+import threading
+import time
+import tty
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "tools"))
+
+import lz4pack  # noqa: E402
+
+spec = importlib.util.spec_from_file_location(
+    "uart_load", os.path.join(HERE, "..", "tools", "uart-load.py"))
+uart_load = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(uart_load)
+
+# from boot.c
+SOF = 0x5A
+HELLO, DATA, JUMP = b"H"[0], b"D"[0], b"J"[0]
+INFLATE, LZ4 = b"I"[0], b"Z"[0]
+ACK, NAK, ERR = b"A"[0], b"N"[0], b"E"[0]
+CHUNK_MAX = 4096
+WINDOW = 8
+HDR = struct.Struct("<BBHII")
+
+LOAD_START = 0x50000000
+LOAD_SIZE = 1 << 20
+
+
+class PtyPort:
+    """Just enough of serial.Serial for hello() and send()."""
+
+    def __init__(self, fd, baudrate, timeout):
+        self.fd = fd
+        self.timeout = timeout
+        self._baud = baudrate
+        tty.setraw(fd)
+
+    @property
+    def baudrate(self):
+        return self._baud
+
+    @baudrate.setter
+    def baudrate(self, baud):
+        # a pty has no line rate, only remember it like the real port
+        self._baud = baud
+
+    def read(self, n):
+        out = b""
+        end = time.monotonic() + self.timeout
+        while len(out) < n:
+            left = end - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                break
+            out += os.read(self.fd, n - len(out))
+        return out
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.fd, view):]
+
+    def reset_input_buffer(self):
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+
+
+class Line:
+    """The wire between the two: reads whole host frames off the pty
+    master, mangles some, and hands the bytes to the target."""
+
+    def __init__(self, fd, rng, rate, lose_final):
+        self.fd = fd
+        self.rng = rng
+        self.rate = rate
+        self.lose_final = lose_final
+        self.bytes = queue.Queue()
+        self.pending = b""
+        self.frames = 0
+        self.faults = {"drop": 0, "corrupt": 0, "truncate": 0, "reply": 0,
+                       "final": 0}
+        threading.Thread(target=self._pump, daemon=True).start()
+
+    def _read(self, n):
+        while len(self.pending) < n:
+            self.pending += os.read(self.fd, 65536)
+        out, self.pending = self.pending[:n], self.pending[n:]
+        return out
+
+    def _fault(self):
+        # never touch the HELLO, and make sure every kind shows up early
+        self.frames += 1
+        forced = {4: "drop", 9: "corrupt", 15: "truncate"}
+        if self.frames in forced:
+            return forced[self.frames]
+        if self.frames > 1 and self.rng.random() < self.rate:
+            return self.rng.choice(("drop", "corrupt", "truncate"))
+        return None
+
+    def _pump(self):
+        try:
+            self._frames()
+        except OSError:
+            pass  # run() closed the pty
+
+    def _frames(self):
+        while True:
+            hdr = self._read(HDR.size)
+            if hdr[0] != SOF:
+                raise RuntimeError("host sent garbage")
+            length = HDR.unpack(hdr)[4]
+            frame = bytearray(hdr + self._read(length + 4))
+
+            fault = self._fault()
+            if fault:
+                self.faults[fault] += 1
+            if fault == "drop":
+                continue
+            if fault == "corrupt":
+                i = self.rng.randrange(1, len(frame))
+                frame[i] ^= 1 << self.rng.randrange(8)
+            if fault == "truncate":
+                frame = frame[:self.rng.randrange(1, len(frame))]
+            for b in frame:
+                self.bytes.put(b)
+
+    def getc(self):
+        return self.bytes.get()
+
+    def read(self, n):
+        return bytes(self.getc() for _ in range(n))
+
+    def reply(self, code, seq, final=False):
+        # a reply can get lost too. the last one only when asked for, so
+        # every run that loses it does so on purpose: after JUMP the
+        # real bootloader is gone and can't repeat it
+        if final and self.lose_final:
+            self.faults["final"] += 1
+            return
+        if not final and self.rng.random() < self.rate:
+            self.faults["reply"] += 1
+            return
+        os.write(self.fd, struct.pack("<BBH", code, WINDOW, seq & 0xFFFF))
+
+
+class Target:
+    """boot.c's kmain loop, one to one."""
+
+    def __init__(self, line):
+        self.line = line
+        self.mem = bytearray(LOAD_SIZE)
+        self.entry = None
+        self.naks = 0
+        self.lz = None  # (addr, size, compressed so far) while open
+        threading.Thread(target=self.run, daemon=True).start()
+
+    def recv_frame(self):
+        while self.line.getc() != SOF:
+            pass
+        rest = self.line.read(HDR.size - 1)
+        _, typ, seq, addr, length = HDR.unpack(bytes([SOF]) + rest)
+        if length > CHUNK_MAX:
+            return None
+        data = self.line.read(length)
+        crc = struct.unpack("<I", self.line.read(4))[0]
+        if crc != zlib.crc32(bytes([SOF]) + rest + data):
+            return None
+        return typ, seq, addr, data
+
+    def in_load_area(self, addr, n):
+        return LOAD_START <= addr and addr + n <= LOAD_START + LOAD_SIZE
+
+    def inflate_close(self):
+        if self.lz is None:
+            return True
+        addr, size, blk = self.lz
+        self.lz = None
+        try:
+            out = lz4pack.decompress_block(bytes(blk))
+        except (IndexError, ValueError):
+            return False
+        if len(out) != size:
+            return False
+        off = addr - LOAD_START
+        self.mem[off:off + size] = out
+        return True
+
+    def nak(self, expect):
+        self.naks += 1
+        self.line.reply(NAK, expect)
+
+    def run(self):
+        expect = 0
+        resync = False
+        while True:
+            f = self.recv_frame()
+            if f is None:
+                if not resync:
+                    self.nak(expect)
+                resync = True
+                continue
+            typ, seq, addr, data = f
+
+            if typ == HELLO:
+                expect = (seq + 1) & 0xFFFF
+                resync = False
+                self.lz = None
+                self.line.reply(ACK, expect)
+                continue
+
+            if seq != expect:
+                if (seq - expect) & 0x8000:
+                    self.line.reply(ACK, expect)
+                else:
+                    if not resync:
+                        self.nak(expect)
+                    resync = True
+                continue
+            resync = False
+
+            if typ == DATA and self.in_load_area(addr, len(data)):
+                off = addr - LOAD_START
+                self.mem[off:off + len(data)] = data
+            elif (typ == INFLATE and len(data) == 4 and self.inflate_close()
+                  and self.in_load_area(addr, struct.unpack("<I", data)[0])):
+                self.lz = (addr, struct.unpack("<I", data)[0], bytearray())
+            elif typ == LZ4 and self.lz is not None:
+                self.lz[2].extend(data)
+            elif (typ == JUMP and self.inflate_close()
+                  and self.in_load_area(addr, 4)):
+                expect = (expect + 1) & 0xFFFF
+                self.line.reply(ACK, expect, final=True)
+                self.entry = addr
+                return
+            else:
+                self.line.reply(ERR, seq)
+                continue
+            expect = (expect + 1) & 0xFFFF
+            self.line.reply(ACK, expect)
+
+
+def image(rng, size):
+    """Zeros, repeated 'code' and noise, roughly like vm.bin."""
+    out = bytearray()
+    code = bytes(rng.randrange(256) for _ in range(64))
+    while len(out) < size:
+        kind = rng.randrange(3)
+        n = rng.randrange(64, 2048)
+        if kind == 0:
+            out += bytes(n)
+        elif kind == 1:
+            out += (code * (n // 64 + 1))[:n]
+        else:
+            out += bytes(rng.randrange(256) for _ in range(n))
+    return bytes(out[:size])
+
+
+def run(name, payload, is_lz4, want, rng, rate, chunk, lose_final=False):
+    master, slave = pty.openpty()
+    line = Line(master, rng, rate, lose_final)
+    target = Target(line)
+    ser = PtyPort(slave, uart_load.BOOT_BAUD, timeout=0.02)
+
+    entry = LOAD_START + 0x40
+    frames, size = uart_load.build(payload, LOAD_START, entry, chunk, is_lz4)
+    start = time.monotonic()
+    window = uart_load.hello(ser, 2000000)
+    try:
+        confirmed = uart_load.send(ser, frames, window, timeout=0.1)
+    except SystemExit as e:
+        print("%s: FAIL, sender gave up: %s" % (name, e))
+        return False
+    secs = time.monotonic() - start
+
+    # the last ack is sent just before the target "jumps"
+    for _ in range(100):
+        if target.entry is not None:
+            break
+        time.sleep(0.01)
+
+    ok = (size == len(want) and target.entry == entry
+          and bytes(target.mem[:len(want)]) == want
+          and not any(target.mem[len(want):])
+          and confirmed != lose_final)
+    every = all(line.faults[k] for k in ("drop", "corrupt", "truncate"))
+    print("%s: %d frames, %d bytes in %.2fs, faults %s, %d naks: %s"
+          % (name, len(frames), size, secs, line.faults, target.naks,
+             "ok" if ok and every and target.naks else "FAIL"))
+    os.close(master)
+    os.close(slave)
+    return ok and every and target.naks > 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("--seed", type=int, default=808)
+    ap.add_argument("--rate", type=float, default=0.05,
+                    help="chance of a fault per frame and per reply")
+    args = ap.parse_args()
+
+    rng = random.Random(args.seed)
+    img = image(rng, 96 * 1024)
+    packed = lz4pack.write_frame(img)
+
+    ok = run("bin", img, False, img, rng, args.rate, CHUNK_MAX)
+    ok &= run("bin/1k", img, False, img, rng, args.rate, 1024)
+    ok &= run("lz4", packed, True, img, rng, args.rate, CHUNK_MAX)
+    ok &= run("lost-jump-ack", img, False, img, rng, args.rate, CHUNK_MAX,
+              lose_final=True)
+    print("uart-load-loopback: %s" % ("ok" if ok else "FAIL"))
+    sys.exit(0 if ok else 1)
+
+
+if __name__ == "__main__":
+    main()
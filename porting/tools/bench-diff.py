@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Compare two captures of lib/bench.c output.
+
+    tools/bench-diff.py before.log after.log [--threshold 5]
+
+Reads the "BENCH name=... median=..." lines out of each log (anything
+else in the capture is ignored) and prints the change per benchmark.
+A median more than --threshold percent slower counts as a regression
+and makes the exit status 1, so this can gate a script.
+"""
+
+import argparse
+import sys
+
+
+def load(path):
+    results = {}
+    for line in open(path, errors="replace"):
+        line = line.strip()
+        if not line.startswith("BENCH "):
+            continue
+        fields = dict(kv.split("=", 1) for kv in line.split()[1:] if "=" in kv)
+        name = fields.pop("name")
+        results[name] = {k: int(v) for k, v in fields.items()}
+    return results
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("before")
+    ap.add_argument("after")
+    ap.add_argument("--threshold", type=float, default=5.0,
+                    help="percent slowdown of the median that fails")
+    ap.add_argument("--field", default="median")
+    args = ap.parse_args()
+
+    old = load(args.before)
+    new = load(args.after)
+    regressions = 0
+
+    print("%-32s %12s %12s %8s" % ("benchmark", "before", "after", "change"))
+    for name in sorted(set(old) | set(new)):
+        if name not in old or name not in new:
+            print("%-32s %s" % (name, "only in " + ("after" if name in new else "before")))
+            continue
+        a = old[name][args.field]
+        b = new[name][args.field]
+        pct = 100.0 * (b - a) / a if a else 0.0
+        mark = ""
+        if pct > args.threshold:
+            mark = "  REGRESSION"
+            regressions += 1
+        elif pct < -args.threshold:
+            mark = "  faster"
+        print("%-32s %12d %12d %+7.1f%%%s" % (name, a, b, pct, mark))
+
+    if regressions:
+        print("%d regression(s) over %.1f%%" % (regressions, args.threshold))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
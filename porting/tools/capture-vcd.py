@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""Convert a lib/capture.c stream into a VCD file for GTKWave.
+
+    tools/capture-vcd.py capture.bin > capture.vcd
+    tools/capture-vcd.py --port /dev/ttyUSB1 --name 17=ir > ir.vcd
+
+Timestamps are rdcycle counts; they are written in ns relative to the
+first edge, using the cycles per second from the stream header. A pin
+is 'x' until its first edge. Gaps where the target's ring overflowed
+are reported on stderr, and --pulses prints every pulse width there
+as well, which is usually all an IR decode needs.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = 0x54504143
+VERSION = 1
+VCD_IDS = "!\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
+
+
+def read_exact(stream, n):
+    data = b""
+    while len(data) < n:
+        chunk = stream.read(n - len(data))
+        if not chunk:
+            sys.exit("capture: stream cut short")
+        data += chunk
+    return data
+
+
+def read_stream(stream):
+    """Skip console output up to the magic, then yield
+    (cps, pins) once followed by (cycles, pin, level) per edge."""
+    window = b""
+    want = struct.pack("<I", MAGIC)
+    while window != want:
+        b = stream.read(1)
+        if not b:
+            sys.exit("capture: no stream found")
+        window = (window + b)[-4:]
+
+    version, cps, lo, hi = struct.unpack("<4I", read_exact(stream, 16))
+    if version != VERSION:
+        sys.exit("capture: unknown version %d" % version)
+    yield cps, lo | hi << 32
+
+    last_dropped = 0
+    while True:
+        n, dropped = struct.unpack("<2I", read_exact(stream, 8))
+        body = read_exact(stream, 8 * n)
+        (crc,) = struct.unpack("<I", read_exact(stream, 4))
+        if zlib.crc32(body) != crc:
+            sys.exit("capture: crc mismatch, stream is corrupt")
+        if dropped != last_dropped:
+            print("capture: %d edges dropped before the next block"
+                  % (dropped - last_dropped), file=sys.stderr)
+            last_dropped = dropped
+        if n == 0:
+            return
+        for (e,) in struct.iter_unpack("<Q", body):
+            yield e >> 8, e & 0x3f, (e >> 7) & 1
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("dump", nargs="?", help="raw capture, or use --port")
+    ap.add_argument("--port")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--name", action="append", default=[],
+                    help="pin=name for the signal list, repeatable")
+    ap.add_argument("--pulses", action="store_true")
+    args = ap.parse_args()
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+    elif args.dump:
+        stream = open(args.dump, "rb")
+    else:
+        stream = sys.stdin.buffer
+
+    names = {}
+    for spec in args.name:
+        pin, name = spec.split("=", 1)
+        names[int(pin)] = name
+
+    edges = read_stream(stream)
+    cps, pins = next(edges)
+    pin_list = [p for p in range(64) if pins >> p & 1]
+    ids = {p: VCD_IDS[i] for i, p in enumerate(pin_list)}
+
+    out = sys.stdout
+    out.write("$timescale 1ns $end\n$scope module gpio $end\n")
+    for p in pin_list:
+        out.write("$var wire 1 %s %s $end\n" % (ids[p], names.get(p, "gpio%d" % p)))
+    out.write("$upscope $end\n$enddefinitions $end\n$dumpvars\n")
+    for p in pin_list:
+        out.write("x%s\n" % ids[p])
+    out.write("$end\n")
+
+    t0 = None
+    last_ns = -1
+    last_edge = {}
+    count = 0
+    for cycles, pin, level in edges:
+        if pin not in ids:
+            continue
+        if t0 is None:
+            t0 = cycles
+        ns = (cycles - t0) * 10**9 // cps
+        if ns != last_ns:
+            out.write("#%d\n" % ns)
+            last_ns = ns
+        out.write("%d%s\n" % (level, ids[pin]))
+        if args.pulses and pin in last_edge:
+            prev_ns, prev_level = last_edge[pin]
+            print("%s %s %d ns" % (names.get(pin, "gpio%d" % pin),
+                                   "high" if prev_level else "low",
+                                   ns - prev_ns), file=sys.stderr)
+        last_edge[pin] = (ns, level)
+        count += 1
+
+    print("capture: %d edges on %d pins at %d Hz"
+          % (count, len(pin_list), cps), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
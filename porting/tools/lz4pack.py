@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""Compress an image into an LZ4 frame for the bootloader.
+
+    tools/lz4pack.py vm.bin vm.lz4      compress, print the ratio
+    tools/lz4pack.py -d vm.lz4 out.bin  decompress
+
+The output is a standard LZ4 frame (lz4 -d reads it, and uart-load.py
+reads frames from the lz4 tool too). The compressor is a plain greedy
+matcher; it is not lz4 -9 but it needs nothing outside the stdlib.
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x184D2204
+MINMATCH = 4
+LASTLITERALS = 5  # the last 5 bytes of a block are always literals
+MFLIMIT = 12  # no match may start in the last 12 bytes
+MAX_OFFSET = 65535
+BLOCK_MAX = 4 << 20  # BD code 7
+
+
+def xxh32(data, seed=0):
+    P1, P2, P3, P4, P5 = 2654435761, 2246822519, 3266489917, 668265263, 374761393
+    M = 0xFFFFFFFF
+
+    def rotl(x, r):
+        return ((x << r) | (x >> (32 - r))) & M
+
+    def round_(acc, v):
+        return rotl((acc + v * P2) & M, 13) * P1 & M
+
+    n = len(data)
+    i = 0
+    if n >= 16:
+        v = [(seed + P1 + P2) & M, (seed + P2) & M, seed, (seed - P1) & M]
+        while i + 16 <= n:
+            for k in range(4):
+                v[k] = round_(v[k], struct.unpack_from("<I", data, i + 4 * k)[0])
+            i += 16
+        h = (rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18)) & M
+    else:
+        h = (seed + P5) & M
+    h = (h + n) & M
+    while i + 4 <= n:
+        h = rotl((h + struct.unpack_from("<I", data, i)[0] * P3) & M, 17) * P4 & M
+        i += 4
+    while i < n:
+        h = rotl((h + data[i] * P5) & M, 11) * P1 & M
+        i += 1
+    h ^= h >> 15
+    h = h * P2 & M
+    h ^= h >> 13
+    h = h * P3 & M
+    h ^= h >> 16
+    return h
+
+
+def _length(out, v):
+    while v >= 255:
+        out.append(255)
+        v -= 255
+    out.append(v)
+
+
+def _sequence(out, lits, offset=0, mlen=0):
+    ll = len(lits)
+    ml = mlen - MINMATCH if offset else 0
+    out.append(min(ll, 15) << 4 | (min(ml, 15) if offset else 0))
+    if ll >= 15:
+        _length(out, ll - 15)
+    out += lits
+    if offset:
+        out += struct.pack("<H", offset)
+        if ml >= 15:
+            _length(out, ml - 15)
+
+
+def compress_block(src):
+    n = len(src)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+    limit = n - LASTLITERALS
+
+    while i < n - MFLIMIT:
+        key = src[i:i + 4]
+        cand = table.get(key)
+        table[key] = i
+        if cand is None or i - cand > MAX_OFFSET:
+            i += 1
+            continue
+
+        mlen = MINMATCH
+        while i + mlen < limit and src[cand + mlen] == src[i + mlen]:
+            mlen += 1
+        while i > anchor and cand > 0 and src[i - 1] == src[cand - 1]:
+            i -= 1
+            cand -= 1
+            mlen += 1
+
+        _sequence(out, src[anchor:i], i - cand, mlen)
+        i += mlen
+        anchor = i
+    _sequence(out, src[anchor:])
+    return bytes(out)
+
+
+def decompress_block(src):
+    out = bytearray()
+    i = 0
+    while True:
+        token = src[i]
+        i += 1
+        ll = token >> 4
+        if ll == 15:
+            while True:
+                b = src[i]
+                i += 1
+                ll += b
+                if b != 255:
+                    break
+        out += src[i:i + ll]
+        i += ll
+        if i == len(src):
+            return bytes(out)
+        offset = src[i] | src[i + 1] << 8
+        i += 2
+        ml = token & 15
+        if ml == 15:
+            while True:
+                b = src[i]
+                i += 1
+                ml += b
+                if b != 255:
+                    break
+        ml += MINMATCH
+        if offset == 0 or offset > len(out):
+            raise ValueError("bad offset")
+        for _ in range(ml):
+            out.append(out[-offset])
+
+
+def write_frame(data):
+    # version 1, independent blocks, content size, no checksums
+    desc = struct.pack("<BBQ", 0x68, 0x70, len(data))
+    out = bytearray(struct.pack("<I", MAGIC) + desc)
+    out.append(xxh32(desc) >> 8 & 0xFF)
+    for off in range(0, len(data), BLOCK_MAX):
+        raw = data[off:off + BLOCK_MAX]
+        blk = compress_block(raw)
+        if len(blk) >= len(raw):
+            out += struct.pack("<I", len(raw) | 1 << 31) + raw
+        else:
+            out += struct.pack("<I", len(blk)) + blk
+    out += struct.pack("<I", 0)
+    return bytes(out)
+
+
+def read_frame(buf):
+    """Yield (compressed, block bytes) for every block in the frame."""
+    magic, flg, bd = struct.unpack_from("<IBB", buf, 0)
+    if magic != MAGIC or flg >> 6 != 1:
+        raise ValueError("not an LZ4 frame")
+    if not flg & 0x20:
+        raise ValueError("linked blocks are not supported")
+    i = 6 + (8 if flg & 0x08 else 0) + (4 if flg & 0x01 else 0) + 1
+    while True:
+        size = struct.unpack_from("<I", buf, i)[0]
+        i += 4
+        if size == 0:
+            return
+        n = size & 0x7FFFFFFF
+        yield not size >> 31, buf[i:i + n]
+        i += n + (4 if flg & 0x10 else 0)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("-d", action="store_true", help="decompress")
+    ap.add_argument("input")
+    ap.add_argument("output")
+    args = ap.parse_args()
+
+    data = open(args.input, "rb").read()
+    if args.d:
+        out = b"".join(decompress_block(b) if c else b
+                       for c, b in read_frame(data))
+    else:
+        out = write_frame(data)
+        print("%s: %d -> %d bytes (%.1f%%)"
+              % (args.input, len(data), len(out),
+                 100.0 * len(out) / max(len(data), 1)), file=sys.stderr)
+    open(args.output, "wb").write(out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+"""Symbolize a lib/prof.c dump into folded stacks.
+
+    tools/prof.py vm.list capture.bin > vm.folded
+    tools/prof.py vm.list --port /dev/ttyUSB1 > vm.folded
+    flamegraph.pl vm.folded > vm.svg
+
+Symbols come from the objdump listing (or an .elf, through $PREFIX-nm)
+the Makefile already produces. With ra in the dump every sample becomes
+caller;function, which is only one level deep but is enough to tell
+which driver is hammering uart_putc. --flat prints a per-function
+summary on stderr as well.
+"""
+
+import argparse
+import bisect
+import collections
+import re
+import struct
+import subprocess
+import sys
+import zlib
+
+MAGIC = 0x464F5250
+VERSION = 1
+FLAG_RA = 1
+
+LABEL = re.compile(r"^([0-9a-f]+) <([^>]+)>:$")
+
+
+def load_symbols(path, prefix):
+    syms = []
+    if path.endswith(".elf"):
+        out = subprocess.run([prefix + "-nm", "-n", path], check=True,
+                             capture_output=True, text=True).stdout
+        for line in out.splitlines():
+            parts = line.split()
+            if len(parts) == 3 and parts[1] in "tTwW":
+                syms.append((int(parts[0], 16), parts[2]))
+    else:
+        for line in open(path):
+            m = LABEL.match(line.strip())
+            if m:
+                syms.append((int(m.group(1), 16), m.group(2)))
+    syms.sort()
+    return [a for a, _ in syms], [n for _, n in syms]
+
+
+def symbolize(addrs, names, pc):
+    i = bisect.bisect_right(addrs, pc) - 1
+    return names[i] if i >= 0 else "0x%x" % pc
+
+
+def read_dump(stream):
+    """Find the magic in stream (console text may come first), then
+    return (rate, flags, samples, dropped)."""
+    window = b""
+    want = struct.pack("<I", MAGIC)
+    while window != want:
+        b = stream.read(1)
+        if not b:
+            sys.exit("prof: no dump found")
+        window = (window + b)[-4:]
+
+    def u32s(n):
+        data = b""
+        while len(data) < 4 * n:
+            chunk = stream.read(4 * n - len(data))
+            if not chunk:
+                sys.exit("prof: dump cut short")
+            data += chunk
+        return data
+
+    version, rate, flags, n, dropped = struct.unpack("<5I", u32s(5))
+    if version != VERSION:
+        sys.exit("prof: unknown version %d" % version)
+    per = 2 if flags & FLAG_RA else 1
+    body = u32s(n * per)
+    (crc,) = struct.unpack("<I", u32s(1))
+    if zlib.crc32(body) != crc:
+        sys.exit("prof: crc mismatch, dump is corrupt")
+    words = struct.unpack("<%dI" % (n * per), body)
+    return rate, flags, [words[i:i + per] for i in range(0, len(words), per)], dropped
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("symbols", help=".list or .elf of the profiled image")
+    ap.add_argument("dump", nargs="?", help="raw capture, or use --port")
+    ap.add_argument("--port")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--prefix", default="riscv64-elf")
+    ap.add_argument("--flat", action="store_true")
+    args = ap.parse_args()
+
+    addrs, names = load_symbols(args.symbols, args.prefix)
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+    elif args.dump:
+        stream = open(args.dump, "rb")
+    else:
+        stream = sys.stdin.buffer
+    rate, flags, samples, dropped = read_dump(stream)
+
+    folded = collections.Counter()
+    flat = collections.Counter()
+    for s in samples:
+        fn = symbolize(addrs, names, s[0])
+        flat[fn] += 1
+        stack = fn
+        if flags & FLAG_RA:
+            caller = symbolize(addrs, names, s[1])
+            if caller != fn:
+                stack = caller + ";" + fn
+        folded[stack] += 1
+
+    for stack, n in sorted(folded.items()):
+        print(stack, n)
+
+    print("prof: %d samples at %d Hz, %d dropped"
+          % (len(samples), rate, dropped), file=sys.stderr)
+    if args.flat:
+        for fn, n in flat.most_common():
+            print("%6.2f%% %8d  %s" % (100.0 * n / len(samples), n, fn),
+                  file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
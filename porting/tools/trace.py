@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Turn a lib/trace.c dump into Chrome trace json.
+
+    make TRACE=1
+    tools/trace.py vm.list capture.bin > vm.json
+    tools/trace.py vm.list --port /dev/ttyUSB1 > vm.json
+
+Open the json in chrome://tracing or ui.perfetto.dev. Each hart is one
+thread; timestamps are rdcycle converted with the cycles per second the
+target reports. The rings only hold the newest events, so exits whose
+entry was overwritten are dropped, and functions still running at dump
+time are closed at the last timestamp.
+"""
+
+import argparse
+import json
+import struct
+import sys
+import zlib
+
+from prof import load_symbols, symbolize
+
+MAGIC = 0x45435254
+VERSION = 1
+EXIT_BIT = 1
+
+
+def read_exact(stream, n):
+    data = b""
+    while len(data) < n:
+        chunk = stream.read(n - len(data))
+        if not chunk:
+            sys.exit("trace: dump cut short")
+        data += chunk
+    return data
+
+
+def read_dump(stream):
+    """Skip console output up to the magic, return (cps, {hart: entries})."""
+    window = b""
+    want = struct.pack("<I", MAGIC)
+    while window != want:
+        b = stream.read(1)
+        if not b:
+            sys.exit("trace: no dump found")
+        window = (window + b)[-4:]
+
+    version, nharts, cps = struct.unpack("<3I", read_exact(stream, 12))
+    if version != VERSION:
+        sys.exit("trace: unknown version %d" % version)
+
+    harts = {}
+    crc = 0
+    for _ in range(nharts):
+        hart, n = struct.unpack("<2I", read_exact(stream, 8))
+        body = read_exact(stream, 16 * n)
+        crc = zlib.crc32(body, crc)
+        harts[hart] = [struct.unpack_from("<2Q", body, 16 * i) for i in range(n)]
+    (want_crc,) = struct.unpack("<I", read_exact(stream, 4))
+    if crc != want_crc:
+        sys.exit("trace: crc mismatch, dump is corrupt")
+    return cps, harts
+
+
+def to_events(cps, harts, addrs, names):
+    starts = [e[0][0] for e in harts.values() if e]
+    if not starts:
+        return []
+    t0 = min(starts)
+
+    def us(cycles):
+        return (cycles - t0) * 1e6 / cps
+
+    events = []
+    for hart, entries in sorted(harts.items()):
+        stack = []
+        for cycles, word in entries:
+            name = symbolize(addrs, names, word & ~EXIT_BIT)
+            if word & EXIT_BIT:
+                if not stack:
+                    continue  # entered before the ring's window
+                stack.pop()
+                ph = "E"
+            else:
+                stack.append(name)
+                ph = "B"
+            events.append({"name": name, "ph": ph, "ts": us(cycles),
+                           "pid": 0, "tid": hart})
+        end = us(entries[-1][0]) if entries else 0
+        while stack:
+            events.append({"name": stack.pop(), "ph": "E", "ts": end,
+                           "pid": 0, "tid": hart})
+    return events
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("symbols", help=".list or .elf of the traced image")
+    ap.add_argument("dump", nargs="?", help="raw capture, or use --port")
+    ap.add_argument("--port")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--prefix", default="riscv64-elf")
+    args = ap.parse_args()
+
+    addrs, names = load_symbols(args.symbols, args.prefix)
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+    elif args.dump:
+        stream = open(args.dump, "rb")
+    else:
+        stream = sys.stdin.buffer
+    cps, harts = read_dump(stream)
+
+    events = to_events(cps, harts, addrs, names)
+    json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, sys.stdout)
+    print("trace: %d events from %d harts"
+          % (sum(len(e) for e in harts.values()), len(harts)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""Send an image to the uart bootloader (boot.c) and jump to it.
+
+    tools/uart-load.py --port /dev/ttyUSB1 vm.bin
+    tools/uart-load.py --port /dev/ttyUSB1 vm.lz4
+
+An .lz4 file (tools/lz4pack.py or the lz4 tool) is sent block by block
+and decompressed on the target as it arrives.
+
+The frame format and the go-back-n rules are described at the top of
+boot.c. Data frames are streamed back to back up to the window the
+target advertises, acks are read as they come in, so the link stays
+busy the whole time.
+"""
+
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+from lz4pack import decompress_block, read_frame
+
+SOF = 0x5A
+HELLO, DATA, JUMP = b"H"[0], b"D"[0], b"J"[0]
+INFLATE, LZ4 = b"I"[0], b"Z"[0]
+ACK, NAK, ERR = b"A"[0], b"N"[0], b"E"[0]
+
+BOOT_BAUD = 115200
+CHUNK_MAX = 4096
+# the JUMP ack is sent once, by a bootloader that is gone right after,
+# so a lost one can't be asked for again. once JUMP is out, this many
+# timeouts in a row without progress mean it ran
+JUMP_RETRIES = 2
+
+
+def frame(typ, seq, addr, data=b""):
+    hdr = struct.pack("<BBHII", SOF, typ, seq & 0xFFFF, addr, len(data))
+    return hdr + data + struct.pack("<I", zlib.crc32(hdr + data))
+
+
+def build(image, addr, entry, chunk, lz4):
+    frames = []
+
+    def add(typ, at, data=b""):
+        frames.append(frame(typ, len(frames) + 1, at, data))
+
+    if lz4:
+        blocks = read_frame(image)
+    else:
+        blocks = [(False, image)]
+    size = 0
+    for compressed, blk in blocks:
+        if compressed:
+            # the target needs the exact size to check the block against
+            out = len(decompress_block(blk))
+            add(INFLATE, addr, struct.pack("<I", out))
+            for off in range(0, len(blk), chunk):
+                add(LZ4, 0, blk[off:off + chunk])
+        else:
+            out = len(blk)
+            for off in range(0, out, chunk):
+                add(DATA, addr + off, blk[off:off + chunk])
+        addr += out
+        size += out
+    add(JUMP, entry)
+    return frames, size
+
+
+def read_reply(ser):
+    """Next (code, window, seq) or None on timeout; skips anything else
+    the target prints."""
+    while True:
+        b = ser.read(1)
+        if not b:
+            return None
+        if b[0] in (ACK, NAK, ERR):
+            rest = ser.read(3)
+            if len(rest) < 3:
+                return None
+            return b[0], rest[0], rest[1] | rest[2] << 8
+
+
+def hello(ser, baud, tries=10):
+    """Start a session at seq 0 and move the link to baud."""
+    ser.reset_input_buffer()
+    for _ in range(tries):
+        ser.write(frame(HELLO, 0, baud if baud != ser.baudrate else 0))
+        r = read_reply(ser)
+        if r and r[0] == ERR:
+            sys.exit("uart-load: bootloader can't do %d baud" % baud)
+        if r and r[0] == ACK and r[2] == 1:
+            if baud != ser.baudrate:
+                time.sleep(0.005)
+                ser.baudrate = baud
+            return r[1]
+    sys.exit("uart-load: no answer from the bootloader")
+
+
+def send(ser, frames, window, timeout):
+    """Go-back-n over frames, which carry seq 1, 2, ... and end with the
+    JUMP. True once the JUMP is acked, False if it was sent but the
+    target went quiet: its ack (and maybe a few before it) got lost and
+    the image most likely runs."""
+    base = 0  # oldest frame not acked yet
+    nxt = 0
+    retries = 0
+    jump_sent = False
+    last = time.monotonic()
+
+    while base < len(frames):
+        while nxt < len(frames) and nxt - base < window:
+            ser.write(frames[nxt])
+            nxt += 1
+        jump_sent |= nxt == len(frames)
+
+        r = read_reply(ser)
+        now = time.monotonic()
+        if r is None:
+            if now - last > timeout:
+                retries += 1
+                if jump_sent and retries > JUMP_RETRIES:
+                    return False
+                if retries > 10:
+                    sys.exit("uart-load: target stopped answering")
+                nxt = base
+                last = now
+            continue
+
+        code, _, seq = r
+        # seq is the next one the target wants, frames[i] is seq i + 1
+        acked = base + ((seq - 1 - base) & 0xFFFF)
+        if code == ERR:
+            sys.exit("uart-load: target rejected frame %d" % seq)
+        if acked > len(frames):
+            continue  # stale
+        if acked > base:
+            base = acked
+            retries = 0
+            last = now
+        if code == NAK:
+            nxt = base
+    return True
+
+
+def main():
+    # only needed for a real port, tests/uart-load-loopback.py brings
+    # its own
+    import serial
+
+    ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    ap.add_argument("image")
+    ap.add_argument("--port", required=True)
+    ap.add_argument("--baud", type=int, default=2000000)
+    ap.add_argument("--addr", type=lambda s: int(s, 0), default=0x50000000)
+    ap.add_argument("--entry", type=lambda s: int(s, 0),
+                    help="defaults to --addr")
+    ap.add_argument("--chunk", type=int, default=CHUNK_MAX)
+    ap.add_argument("--timeout", type=float, default=0.5)
+    ap.add_argument("--monitor", type=int, metavar="BAUD", default=115200,
+                    help="print what the image says at this rate, 0 to exit")
+    args = ap.parse_args()
+
+    image = open(args.image, "rb").read()
+    entry = args.entry if args.entry is not None else args.addr
+    chunk = min(args.chunk, CHUNK_MAX)
+
+    frames, size = build(image, args.addr, entry, chunk,
+                         args.image.endswith(".lz4"))
+
+    ser = serial.Serial(args.port, BOOT_BAUD, timeout=0.05)
+    window = hello(ser, args.baud)
+
+    start = time.monotonic()
+    jumped = send(ser, frames, window, args.timeout)
+    secs = time.monotonic() - start
+    print("uart-load: %d bytes (%d sent) in %.2fs (%.0f KB/s), %s %#x"
+          % (size, len(image), secs, size / secs / 1024,
+             "jumped to" if jumped else "sent, jump not confirmed, to",
+             entry),
+          file=sys.stderr)
+
+    if not args.monitor:
+        return
+    ser.baudrate = args.monitor
+    ser.timeout = None
+    try:
+        while True:
+            sys.stdout.buffer.write(ser.read(ser.in_waiting or 1))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// UART1 -> UART2 at 2, 3 and 4 Mbaud. the sender keeps the tx fifo
+// topped up all the time; three runs per rate:
+//  - slow reader (rx fifo emptied once every PUMP_US), no flow control:
+//    the rx fifo overflows and UART_INT_RX_FER says so
+//  - slow reader with RTS/CTS: the sender just gets held off and every
+//    byte arrives
+//  - full-rate reader (pumps on every pass) with RTS/CTS: what a real
+//    transfer should look like, every byte at close to line rate and
+//    no overrun
+
+//
+// jumpers: 4 -> 9 (tx1 -> rx2), 10 -> 7 (rts2 -> cts1). 6/11 and 8/5
+// are the other direction's handshake and data and can stay open.
+
+#define NBYTES   (16 * 1024)
+// the 32 byte rx fifo fills in 160us at 2 Mbaud (320 bits), so this is
+// a dozen fifos' worth of line time between pumps
+#define PUMP_US  2000
+#define FULL     0 // pump_us for the full-rate reader
+
+static uint8_t ring_buf[4096];
+static struct uart_ring ring;
+
+static uint8_t pattern(uint32_t i) {
+    return i ^ (i >> 8);
+}
+
+static void run(unsigned baud, bool flow, unsigned pump_us) {
+    struct uart_baud b;
+    uart_baud_calc(baud, &b);
+    bench_put(UART0, "baud ", baud, "");
+    bench_put(UART0, " actual ", b.actual, "");
+    bench_put(UART0, " error ", b.error_ppm, "");
+    uart_puts(UART0, flow ? " ppm, rts/cts, " : " ppm, no flow control, ");
+    uart_puts(UART0, pump_us == FULL ? "full-rate reader: " : "slow reader: ");
+
+    struct uart_config cfg = UART_CONFIG_DEFAULT(baud);
+    cfg.flow_control = flow;
+    cfg.rx_fifo_th = 16;
+    cfg.rx_timeout = 16;
+    if (!uart_configure(UART1, &cfg) || !uart_configure(UART2, &cfg)) {
+        uart_puts(UART0, "refused\r\n");
+        return;
+    }
+
+    uart_ring_init(&ring, UART2, ring_buf, sizeof(ring_buf));
+    uart_int_clear(UART2, UART_INT_ALL);
+
+    uint64_t hz = cycle_cnt_hz();
+    uint64_t pump_cycles = pump_us * hz / 1000000;
+    uint32_t sent = 0, got = 0, bad = 0;
+    uint64_t now = cycle_cnt_read(), start = now;
+    uint64_t idle_since = now, next_pump = now + pump_cycles;
+    while (got < NBYTES) {
+        while (sent < NBYTES && uart_can_putc(UART1))
+            uart_putc(UART1, pattern(sent++));
+
+        now = cycle_cnt_read();
+        if ((int64_t)(now - next_pump) < 0)
+            continue;
+        next_pump = now + pump_cycles;
+
+        if (uart_ring_pump(&ring))
+            idle_since = now;
+        while (uart_ring_count(&ring))
+            bad += uart_ring_getc(&ring) != pattern(got++);
+
+        // without flow control the lost bytes never come
+        if (now - idle_since > hz / 10)
+            break;
+    }
+    uint64_t cycles = cycle_cnt_read() - start;
+
+    uint32_t sts = uart_int_status(UART2);
+    bench_put(UART0, "", got, "");
+    bench_put(UART0, " of ", NBYTES, "");
+    bench_put(UART0, " bytes, ", bad, "");
+    uart_puts(UART0, " mismatched");
+    if (sts & UART_INT_RX_FER)
+        uart_puts(UART0, ", rx overrun");
+    if (pump_us == FULL && got == NBYTES) {
+        // 10 bits a byte on the wire
+        uint64_t bps = got * hz / cycles;
+        bench_put(UART0, ", ", bps, " bytes/s");
+        bench_put_tenths(UART0, ", ", bps * 10 * 1000 / b.actual,
+                         "% of line rate");
+    }
+    uart_puts(UART0, "\r\n");
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "uart-fast\r\n");
+    bench_put(UART0, "cpu hz: ", cycle_cnt_calibrate(UART0, 115200), "\r\n");
+
+    // unrouted, the runs would still "work" and report overruns
+    if (uart_route(UART1, 4, 5, 6, 7) != UART_ROUTE_OK ||
+        uart_route(UART2, 8, 9, 10, 11) != UART_ROUTE_OK) {
+        uart_puts(UART0, "uart1/2 routing refused\r\n");
+    } else {
+        static const unsigned bauds[] = { 2000000, 3000000, 4000000 };
+        for (unsigned i = 0; i < 3; i++) {
+            run(bauds[i], false, PUMP_US);
+            run(bauds[i], true, PUMP_US);
+            run(bauds[i], true, FULL);
+        }
+    }
+
+    while (1)
+        asm volatile("wfi");
+}
@@ -0,0 +1,45 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// all three uarts at once. UART0 stays on the console pins the boot
+// rom set up; UART1 and UART2 are routed through lib/uartmux.c, and a
+// route that would steal one of their mux signals has to be refused.
+// put a usb serial adapter on each tx pin to see the output.
+
+#define U1_TX 4
+#define U1_RX 5
+#define U2_TX 8
+#define U2_RX 9
+
+static void report(const char *what, int rc) {
+    uart_puts(UART0, what);
+    uart_puts(UART0, rc == UART_ROUTE_OK ? "ok"
+                     : rc == UART_ROUTE_EBUSY ? "busy" : "invalid");
+    uart_puts(UART0, "\r\n");
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "uart-route\r\n");
+
+    report("uart1 4/5:          ", uart_route(UART1, U1_TX, U1_RX, UART_NOPIN, UART_NOPIN));
+    report("uart2 8/9:          ", uart_route(UART2, U2_TX, U2_RX, UART_NOPIN, UART_NOPIN));
+
+    // 16 % 12 == 4, which UART1 tx already has
+    report("uart2 16/17 (busy): ", uart_route(UART2, 16, 17, UART_NOPIN, UART_NOPIN));
+    // tx and rx on one signal
+    report("uart2 8/20 (inval): ", uart_route(UART2, U2_TX, 20, UART_NOPIN, UART_NOPIN));
+    // the refused routes must not have touched uart2
+    uart_puts(UART0, "uart2 tx still on:  ");
+    uart_putdec(UART0, uart_routed_pin(UART2, UARTMUX_TX));
+    uart_puts(UART0, "\r\n");
+
+    if (!uart_init(UART1, 115200) || !uart_init(UART2, 115200))
+        uart_puts(UART0, "uart1/2 init refused\r\n");
+
+    while (1) {
+        uart_puts(UART1, "hello from uart1\r\n");
+        uart_puts(UART2, "hello from uart2\r\n");
+        delay_ms(1000);
+    }
+}
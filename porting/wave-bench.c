@@ -0,0 +1,126 @@
+#define LOG_LEVEL 3
+#include "lib.h"
+
+// timing error of the old bb.c macro bit-banger against lib/wave.c,
+// sending the same frame (leader, 0x48 msb first, stop) on PIN.
+//
+// the macros time every carrier half period with delay_us(13) on top
+// of a get32/put32 pair and round the number of periods down, so the
+// carrier is off frequency and the mark/space edges wander further
+// from where they belong as the frame goes on. we stamp every mark/space
+// boundary they produce and compare it with where it should be. the
+// engine reports how late each edge was against its own deadline,
+// which is the same ideal schedule.
+
+#define PIN      17
+#define FREQ     (38 * 1000)
+#define NSTEPS   64
+#define NRUNS    8
+
+// --- the old macros, with a timestamp at every boundary ---
+
+#define DELAY_US    ((1000 * 1000) / (FREQ * 2))
+#define VAL_N_US(us)   (((us) * FREQ) / 1000000)
+
+static volatile uint32_t *const gpio_cfg0 = (volatile uint32_t *)0x200008c4;
+
+static uint64_t stamps[NSTEPS];
+static unsigned nstamps;
+
+#define STAMP() (stamps[nstamps++] = cycle_cnt_read())
+
+#define ON(pin)  put32(gpio_cfg0 + (pin), get32(gpio_cfg0 + (pin)) | (1 << 25))
+#define OFF(pin) put32(gpio_cfg0 + (pin), get32(gpio_cfg0 + (pin)) | (1 << 26))
+
+#define MARK(pin, duration_us) do { \
+    STAMP(); \
+    for (int _i = 0; _i < VAL_N_US(duration_us); _i++) { \
+        ON(pin); \
+        delay_us(DELAY_US); \
+        OFF(pin); \
+        delay_us(DELAY_US); \
+    } \
+} while (0)
+
+#define SPACE(us) do { STAMP(); delay_us(us); } while (0)
+
+static void macro_frame(uint8_t byte) {
+    MARK(PIN, 9000);
+    SPACE(4500);
+    for (int i = 7; i >= 0; i--) {
+        MARK(PIN, 600);
+        SPACE((byte >> i) & 1 ? 1600 : 600);
+    }
+    MARK(PIN, 600);
+    STAMP();
+}
+
+// --- the same frame for the engine ---
+
+static struct wave_step steps[NSTEPS];
+static struct wave frame;
+
+static void build(uint8_t byte) {
+    wave_init(&frame, steps, NSTEPS, FREQ);
+    wave_mark(&frame, WAVE_US(9000));
+    wave_space(&frame, WAVE_US(4500));
+    for (int i = 7; i >= 0; i--) {
+        wave_mark(&frame, WAVE_US(600));
+        wave_space(&frame, (byte >> i) & 1 ? WAVE_US(1600) : WAVE_US(600));
+    }
+    wave_mark(&frame, WAVE_US(600));
+}
+
+void kmain(void) {
+    uart_init(UART0, 115200);
+    uart_puts(UART0, "wave-bench\r\n");
+    bench_put(UART0, "cpu hz: ", cycle_cnt_calibrate(UART0, 115200), "\r\n");
+
+    gpio_set_output(PIN);
+    build(0x48);
+
+    uint64_t macro_max = 0, macro_sum = 0;
+    int64_t macro_drift = 0;
+    for (unsigned r = 0; r < NRUNS; r++) {
+        nstamps = 0;
+        uint64_t flags = irq_save();
+        macro_frame(0x48);
+        irq_restore(flags);
+
+        // boundary i belongs at start + the length of steps 0..i-1
+        uint64_t ideal = stamps[0];
+        for (unsigned i = 0; i < nstamps; i++) {
+            uint64_t err = stamps[i] > ideal ? stamps[i] - ideal : ideal - stamps[i];
+            macro_max = err > macro_max ? err : macro_max;
+            macro_sum += err;
+            if (i < frame.n)
+                ideal += frame.steps[i].cycles;
+        }
+        macro_drift += (int64_t)(stamps[nstamps - 1] - ideal);
+        delay_ms(100);
+    }
+
+    uint64_t wave_max = 0, wave_sum = 0, wave_edges = 0;
+    int64_t wave_drift = 0;
+    for (unsigned r = 0; r < NRUNS; r++) {
+        struct wave_stats st;
+        wave_play(&frame, PIN, &st);
+        wave_max = st.max_late > wave_max ? st.max_late : wave_max;
+        wave_sum += st.sum_late;
+        wave_edges += st.edges;
+        wave_drift += st.drift;
+        delay_ms(100);
+    }
+
+    uart_puts(UART0, "macros, mark/space boundaries:\r\n");
+    bench_put_cycles(UART0, "  max error:   ", macro_max);
+    bench_put_cycles(UART0, "  mean error:  ", macro_sum / (NRUNS * nstamps));
+    bench_put_cycles(UART0, "  end drift:   ", macro_drift / NRUNS);
+    uart_puts(UART0, "wave_play, every edge incl. carrier:\r\n");
+    bench_put_cycles(UART0, "  max late:    ", wave_max);
+    bench_put_cycles(UART0, "  mean late:   ", wave_sum / wave_edges);
+    bench_put_cycles(UART0, "  end drift:   ", wave_drift / NRUNS);
+
+    while (1)
+        asm volatile("wfi");
+}